@@ -0,0 +1,62 @@
+#ifndef STATIC_FACTORY_BENCH_H
+#define STATIC_FACTORY_BENCH_H
+
+#include "perf_counters.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <string_view>
+
+namespace bench
+{
+
+// keep value alive, so that the computation producing it is not optimized away
+template <typename T>
+inline void do_not_optimize(T const& value)
+{
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+//
+// run func(i) for i in [0, iterations) after a warm up pass and print the time per operation
+// and the throughput, followed by the hardware counters per operation when they are enabled
+// (see perf_counters). returns the elapsed seconds
+//
+template <typename Func>
+double run(std::string_view name, size_t iterations, Func&& func)
+{
+  for(size_t i = 0; i < iterations / 10; ++i)
+  {
+    func(i);
+  }
+
+  perf_counters counters;
+
+  counters.start();
+  auto start = std::chrono::steady_clock::now();
+  for(size_t i = 0; i < iterations; ++i)
+  {
+    func(i);
+  }
+  auto stop   = std::chrono::steady_clock::now();
+  auto values = counters.stop(iterations);
+
+  double seconds = std::chrono::duration<double>(stop - start).count();
+
+  std::printf("%-40.*s %10.1f ns/op %12.0f ops/s\n",
+    static_cast<int>(name.size()),
+    name.data(),
+    seconds * 1e9 / static_cast<double>(iterations),
+    static_cast<double>(iterations) / seconds);
+
+  if(counters.enabled())
+  {
+    perf_counters::print(values);
+  }
+
+  return seconds;
+}
+
+} // namespace bench
+
+#endif // STATIC_FACTORY_BENCH_H
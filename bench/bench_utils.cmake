@@ -0,0 +1,17 @@
+#
+# helpers shared by the benchmark scripts
+#
+
+# current time in microseconds
+macro(bench_now var)
+  string(TIMESTAMP ${var} "%s%f")
+endmacro()
+
+# format the time elapsed between two bench_now as seconds with 3 decimals
+function(bench_elapsed start stop var)
+  math(EXPR elapsed_ms "(${stop} - ${start}) / 1000")
+  math(EXPR seconds "${elapsed_ms} / 1000")
+  math(EXPR milliseconds "${elapsed_ms} % 1000 + 1000")
+  string(SUBSTRING "${milliseconds}" 1 3 milliseconds)
+  set(${var} "${seconds}.${milliseconds}" PARENT_SCOPE)
+endfunction()
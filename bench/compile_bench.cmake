@@ -0,0 +1,59 @@
+#
+# compile time and object size of N registrations, each with its own argument types so that every
+# registration instantiates its own make and register paths.
+#
+# cmake -DCOMPILER=c++ -DFLAGS=-O2 -DINCLUDE_DIR=include -DOUTPUT_DIR=out -DCOUNTS="10;100" -P compile_bench.cmake
+#
+
+foreach(var COMPILER INCLUDE_DIR OUTPUT_DIR COUNTS)
+  if(NOT DEFINED ${var})
+    message(FATAL_ERROR "compile_bench: ${var} is not defined")
+  endif()
+endforeach()
+
+include(${CMAKE_CURRENT_LIST_DIR}/bench_utils.cmake)
+
+separate_arguments(FLAGS UNIX_COMMAND "${FLAGS}")
+
+file(MAKE_DIRECTORY ${OUTPUT_DIR})
+
+message(STATUS "registrations  compile time (s)  object size (bytes)")
+
+foreach(count ${COUNTS})
+  set(source "#include <static_factory.hpp>\n\n#include <type_traits>\n\nstruct Base\n{\n  virtual ~Base() = default;\n};\n\n")
+
+  math(EXPR last "${count} - 1")
+  foreach(i RANGE ${last})
+    string(APPEND source "struct Type${i} : Base\n{\n  explicit Type${i}(std::integral_constant<int, ${i}>) {}\n};\n\n")
+  endforeach()
+
+  string(APPEND source "void register_all()\n{\n")
+  foreach(i RANGE ${last})
+    string(APPEND source "  static_factory<Base>::register_type<Type${i}, std::integral_constant<int, ${i}>>(\"Type${i}\");\n")
+  endforeach()
+  string(APPEND source "}\n\nvoid make_all()\n{\n")
+  foreach(i RANGE ${last})
+    string(APPEND source "  static_factory<Base>::make_unique(\"Type${i}\", std::integral_constant<int, ${i}>());\n")
+  endforeach()
+  string(APPEND source "}\n")
+
+  set(source_file ${OUTPUT_DIR}/registrations_${count}.cpp)
+  set(object_file ${OUTPUT_DIR}/registrations_${count}.o)
+  file(WRITE ${source_file} "${source}")
+
+  bench_now(start)
+  execute_process(
+    COMMAND ${COMPILER} -std=c++20 ${FLAGS} -I${INCLUDE_DIR} -c ${source_file} -o ${object_file}
+    RESULT_VARIABLE result)
+  bench_now(stop)
+
+  if(NOT result EQUAL 0)
+    message(FATAL_ERROR "compile_bench: compilation of ${source_file} failed")
+  endif()
+
+  bench_elapsed(${start} ${stop} elapsed)
+
+  file(SIZE ${object_file} size)
+
+  message(STATUS "${count}  ${elapsed}  ${size}")
+endforeach()
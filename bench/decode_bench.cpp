@@ -0,0 +1,120 @@
+//
+// decode rate of wire messages: make_from_bytes with a type keeping a view into the buffer, with a
+// type copying the payload, and parsing into a temporary before make.
+//
+
+#include "bench.hpp"
+
+#include <static_factory.hpp>
+
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+
+struct Message
+{
+  virtual ~Message() = default;
+
+  virtual size_t size() const = 0;
+};
+
+struct ViewMessage : Message
+{
+  explicit ViewMessage(std::span<const std::byte> bytes)
+    : text{reinterpret_cast<const char*>(bytes.data()), bytes.size()}
+  {
+  }
+
+  size_t size() const override
+  {
+    return text.size();
+  }
+
+  std::string_view text;
+};
+
+struct CopyMessage : Message
+{
+  explicit CopyMessage(std::string t) : text{std::move(t)}
+  {
+  }
+
+  size_t size() const override
+  {
+    return text.size();
+  }
+
+  std::string text;
+};
+
+// a payload in the buffer
+struct record
+{
+  size_t offset;
+  size_t size;
+};
+
+} // namespace
+
+int main()
+{
+  constexpr size_t record_count = 1 << 16;
+  constexpr size_t payload_size = 256;
+  constexpr size_t iterations   = 1 << 22;
+
+  std::vector<std::byte> buffer;
+  std::vector<record> records;
+  for(size_t i = 0; i < record_count; ++i)
+  {
+    records.push_back({buffer.size(), payload_size});
+    buffer.resize(buffer.size() + payload_size, std::byte('a' + i % 26));
+  }
+
+  using factory = static_factory<Message>;
+
+  const std::string view_key = "View";
+  const std::string copy_key = "Copy";
+
+  factory::register_deserializer<ViewMessage>(view_key);
+  factory::register_deserializer<CopyMessage>(copy_key,
+    [](std::span<const std::byte> bytes)
+    {
+      return CopyMessage(std::string(reinterpret_cast<const char*>(bytes.data()), bytes.size()));
+    });
+  factory::register_type<CopyMessage, std::string>(copy_key);
+
+  auto payload = [&](size_t i)
+  {
+    auto& r = records[i % record_count];
+    return std::span<const std::byte>(buffer.data() + r.offset, r.size);
+  };
+
+  bench::run("make_from_bytes, view",
+    iterations,
+    [&](size_t i)
+    {
+      bench::do_not_optimize(factory::make_from_bytes(view_key, payload(i))->size());
+    });
+
+  bench::run("make_from_bytes, copy",
+    iterations,
+    [&](size_t i)
+    {
+      bench::do_not_optimize(factory::make_from_bytes(copy_key, payload(i))->size());
+    });
+
+  bench::run("parse then make",
+    iterations,
+    [&](size_t i)
+    {
+      auto bytes = payload(i);
+      std::string parsed(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+      bench::do_not_optimize(factory::make_unique(copy_key, parsed)->size());
+    });
+
+  return 0;
+}
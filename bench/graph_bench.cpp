@@ -0,0 +1,123 @@
+//
+// load time of a config of 100k nodes with graph_loader, single threaded and parallel
+//
+
+#include "bench.hpp"
+
+#include <static_factory_graph.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include <unistd.h>
+
+namespace
+{
+
+struct Node
+{
+  virtual ~Node() = default;
+
+  virtual size_t count() const = 0;
+};
+
+template <typename Pointer>
+struct Operator : Node
+{
+  explicit Operator(graph_node<Pointer>&& node)
+    : name{node.args.empty() ? "" : node.args[0]},
+      children{std::move(node.children)}
+  {
+  }
+
+  size_t count() const override
+  {
+    size_t result = 1;
+    for(auto& child : children)
+    {
+      result += child->count();
+    }
+    return result;
+  }
+
+  std::string_view name;
+  std::vector<Pointer> children;
+};
+
+using factory = static_factory<Node>;
+
+// a tree of fanout children per node and 8 levels, of at most remaining nodes
+void write_config(std::ofstream& out, size_t& remaining, size_t depth, size_t fanout)
+{
+  static const char* keys[] = {"source", "filter", "map", "join", "sink"};
+
+  --remaining;
+  out << keys[depth % 5] << "(\"op" << remaining << "\", 42)";
+  if(remaining == 0 || depth == 7)
+  {
+    out << "\n";
+    return;
+  }
+
+  out << " {\n";
+  for(size_t i = 0; i < fanout && remaining > 0; ++i)
+  {
+    write_config(out, remaining, depth + 1, fanout);
+  }
+  out << "}\n";
+}
+
+template <typename Pointer>
+void measure(const char* name, const std::string& path, typename graph_loader<factory>::options opts)
+{
+  size_t count = 0;
+  auto start   = std::chrono::steady_clock::now();
+  if constexpr(std::is_same_v<Pointer, std::shared_ptr<Node>>)
+  {
+    auto graph = graph_loader<factory>::load_shared(path, opts);
+    count      = graph.roots[0]->count();
+  }
+  else
+  {
+    auto graph = graph_loader<factory>::load_unique(path, opts);
+    count      = graph.roots[0]->count();
+  }
+  auto stop = std::chrono::steady_clock::now();
+
+  bench::do_not_optimize(count);
+  std::printf("%-32s %8zu nodes %10.2f ms\n",
+    name,
+    count,
+    std::chrono::duration<double, std::milli>(stop - start).count());
+}
+
+} // namespace
+
+int main()
+{
+  for(auto key : {"source", "filter", "map", "join", "sink"})
+  {
+    factory::register_type<Operator<std::unique_ptr<Node>>, graph_node<std::unique_ptr<Node>>>(key);
+    factory::register_type<Operator<std::shared_ptr<Node>>, graph_node<std::shared_ptr<Node>>>(key);
+  }
+
+  char path[] = "/tmp/static_factory_graph_bench_XXXXXX";
+  ::close(::mkstemp(path));
+
+  {
+    std::ofstream out(path);
+    size_t remaining = 100'000;
+    write_config(out, remaining, 0, 5);
+  }
+
+  measure<std::unique_ptr<Node>>("make_unique, 1 thread", path, {.threads = 1});
+  measure<std::unique_ptr<Node>>("make_unique, parallel", path, {});
+  measure<std::shared_ptr<Node>>("make_shared, 1 thread", path, {.threads = 1});
+  measure<std::shared_ptr<Node>>("make_shared, parallel", path, {});
+
+  ::unlink(path);
+
+  return 0;
+}
@@ -0,0 +1,240 @@
+//
+// make* and try_make* under skewed key popularity: Zipf distributed keys of random lengths, a mix
+// of signatures and of registrations, for several storage and locking policies
+//
+
+#include "bench.hpp"
+#include "load_generator.hpp"
+
+#include <static_factory.hpp>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+struct Shape
+{
+  virtual ~Shape() = default;
+
+  virtual int sides() const = 0;
+};
+
+struct Polygon : Shape
+{
+  Polygon() = default;
+
+  explicit Polygon(int s) : m_sides{s}
+  {
+  }
+
+  explicit Polygon(const std::string& name) : m_sides{int(name.size())}
+  {
+  }
+
+  int sides() const override
+  {
+    return m_sides;
+  }
+
+  int m_sides = 3;
+};
+
+// base type made by value, for make and try_make
+struct Value
+{
+  int sides = 3;
+};
+
+struct PolygonValue : Value
+{
+  PolygonValue() = default;
+
+  explicit PolygonValue(int s) : Value{s}
+  {
+  }
+
+  explicit PolygonValue(const std::string& name) : Value{int(name.size())}
+  {
+  }
+};
+
+struct hashed_policies : factory_policies::defaults
+{
+  using storage = factory_policies::hashed_storage;
+  using locking = factory_policies::shared_mutex_locking;
+};
+
+struct single_threaded_policies : factory_policies::defaults
+{
+  using locking = factory_policies::no_locking;
+};
+
+// the arguments of the signatures (), (int) and (std::string)
+const std::string g_name = "square";
+
+template <typename Policies>
+struct workload
+{
+  using pointers = static_factory<Shape, std::string, Policies>;
+  using values   = static_factory<Value, std::string, Policies>;
+
+  static void register_key(const std::string& key, uint16_t signature)
+  {
+    switch(signature)
+    {
+      case 0:
+        pointers::template register_type<Polygon>(key);
+        values::template register_type<PolygonValue>(key);
+        break;
+      case 1:
+        pointers::template register_type<Polygon, int>(key);
+        values::template register_type<PolygonValue, int>(key);
+        break;
+      default:
+        pointers::template register_type<Polygon, const std::string&>(key);
+        values::template register_type<PolygonValue, const std::string&>(key);
+        break;
+    }
+  }
+
+  static void register_keys(const bench::load_generator& generator)
+  {
+    for(auto& key : generator.keys())
+    {
+      for(uint16_t signature = 0; signature < generator.options().signature_mix.size(); ++signature)
+      {
+        register_key(key, signature);
+      }
+    }
+  }
+
+  static void execute(const bench::operation& op, const std::vector<std::string>& keys)
+  {
+    auto& key = keys[op.key];
+
+    if(op.write)
+    {
+      register_key(key, op.signature);
+      return;
+    }
+
+    switch(op.signature)
+    {
+      case 0:
+        call(op.call, key);
+        break;
+      case 1:
+        call(op.call, key, int(op.key));
+        break;
+      default:
+        call(op.call, key, g_name);
+        break;
+    }
+  }
+
+  template <typename... Args>
+  static void call(bench::flavour flavour, const std::string& key, const Args&... args)
+  {
+    switch(flavour)
+    {
+      case bench::flavour::make:
+        bench::do_not_optimize(values::make(key, args...).sides);
+        break;
+      case bench::flavour::make_ptr:
+        delete pointers::make_ptr(key, args...);
+        break;
+      case bench::flavour::make_shared:
+        bench::do_not_optimize(pointers::make_shared(key, args...));
+        break;
+      case bench::flavour::make_unique:
+        bench::do_not_optimize(pointers::make_unique(key, args...));
+        break;
+      case bench::flavour::try_make:
+        bench::do_not_optimize(values::try_make(args...).sides);
+        break;
+      case bench::flavour::try_make_ptr:
+        delete pointers::try_make_ptr(args...);
+        break;
+      case bench::flavour::try_make_shared:
+        bench::do_not_optimize(pointers::try_make_shared(args...));
+        break;
+      case bench::flavour::try_make_unique:
+        bench::do_not_optimize(pointers::try_make_unique(args...));
+        break;
+    }
+  }
+
+  static void run(const char* config, bench::load_options options, size_t iterations)
+  {
+    bench::load_generator generator(options);
+    register_keys(generator);
+
+    auto operations = generator.operations(1 << 16);
+    auto& keys      = generator.keys();
+
+    char name[128];
+    std::snprintf(name,
+      sizeof(name),
+      "%s s=%.2f w=%.2f",
+      config,
+      options.zipf_exponent,
+      options.write_ratio);
+
+    bench::run(name,
+      iterations,
+      [&](size_t i)
+      {
+        execute(operations[i % operations.size()], keys);
+      });
+  }
+};
+
+} // namespace
+
+int main()
+{
+  constexpr size_t iterations = 1 << 21;
+
+  bench::load_options options;
+  options.signature_mix = {0.6, 0.3, 0.1};
+
+  {
+    bench::load_generator generator(options);
+    std::printf("%zu keys of %zu to %zu chars, s=%.2f: the top 1%% keys take %.0f%% of the calls\n\n",
+      options.key_count,
+      options.min_key_length,
+      options.max_key_length,
+      options.zipf_exponent,
+      100 * generator.head(options.key_count / 100));
+  }
+
+  // make, make_ptr, make_shared and make_unique in equal parts
+  for(double exponent : {0.0, 0.99, 1.2})
+  {
+    options.zipf_exponent = exponent;
+    workload<factory_policies::defaults>::run("linear mutex", options, iterations);
+    workload<hashed_policies>::run("hashed shared_mutex", options, iterations);
+    workload<single_threaded_policies>::run("linear no_locking", options, iterations);
+  }
+
+  options.zipf_exponent = 0.99;
+  options.write_ratio   = 0.01;
+  workload<factory_policies::defaults>::run("linear mutex", options, iterations);
+  workload<hashed_policies>::run("hashed shared_mutex", options, iterations);
+  options.write_ratio = 0;
+
+  // one flavour at a time
+  std::printf("\n");
+  for(size_t f = 0; f < bench::flavour_count; ++f)
+  {
+    options.flavour_mix    = std::vector<double>(bench::flavour_count, 0);
+    options.flavour_mix[f] = 1;
+
+    char config[64];
+    std::snprintf(config, sizeof(config), "hashed %s", bench::flavour_name(bench::flavour(f)));
+    workload<hashed_policies>::run(config, options, iterations / 4);
+  }
+}
@@ -0,0 +1,201 @@
+#ifndef STATIC_FACTORY_LOAD_GENERATOR_H
+#define STATIC_FACTORY_LOAD_GENERATOR_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace bench
+{
+
+// the factory call of an operation
+enum class flavour : uint8_t
+{
+  make,
+  make_ptr,
+  make_shared,
+  make_unique,
+  try_make,
+  try_make_ptr,
+  try_make_shared,
+  try_make_unique
+};
+
+inline constexpr size_t flavour_count = 8;
+
+inline const char* flavour_name(flavour f)
+{
+  static const char* names[flavour_count] = {"make",
+    "make_ptr",
+    "make_shared",
+    "make_unique",
+    "try_make",
+    "try_make_ptr",
+    "try_make_shared",
+    "try_make_unique"};
+  return names[size_t(f)];
+}
+
+struct load_options
+{
+  size_t key_count       = 1024;
+  double zipf_exponent   = 0.99; // 0 for uniform keys
+  bool shuffle_ranks     = true; // popularity independent of the registration order
+  size_t min_key_length  = 8;    // key lengths are uniform in [min_key_length, max_key_length]
+  size_t max_key_length  = 32;
+  double write_ratio     = 0;    // share of the operations registering a key instead of making it
+  uint64_t seed          = 42;
+
+  std::vector<double> signature_mix = {1};                       // weight of each signature
+  std::vector<double> flavour_mix   = std::vector<double>(4, 1); // weight of each flavour, in flavour order
+};
+
+struct operation
+{
+  uint32_t key;       // index in keys()
+  uint16_t signature; // index in signature_mix
+  flavour call;
+  bool write;         // register the key instead of making it
+};
+
+//
+// Zipf distribution over [0, n): rank k is drawn with a probability proportional to 1 / (k + 1)^s.
+// sampled by binary search in the cumulative distribution
+//
+class zipf_distribution
+{
+  public:
+  zipf_distribution(size_t n, double exponent) : m_cdf(n)
+  {
+    double sum = 0;
+    for(size_t k = 0; k < n; ++k)
+    {
+      sum += 1 / std::pow(double(k + 1), exponent);
+      m_cdf[k] = sum;
+    }
+    for(auto& p : m_cdf)
+    {
+      p /= sum;
+    }
+  }
+
+  template <typename Generator>
+  size_t operator()(Generator& generator) const
+  {
+    auto u  = std::uniform_real_distribution<double>(0, 1)(generator);
+    auto it = std::lower_bound(m_cdf.begin(), m_cdf.end(), u);
+    return std::min(size_t(it - m_cdf.begin()), m_cdf.size() - 1);
+  }
+
+  // probability of the ranks [0, k)
+  double head(size_t k) const
+  {
+    return k == 0 ? 0 : m_cdf[std::min(k, m_cdf.size()) - 1];
+  }
+
+  private:
+  std::vector<double> m_cdf;
+};
+
+/**
+ * \brief The load_generator class generates skewed factory workloads.
+ *
+ * The keys are random strings of uniform lengths, drawn with a Zipf distribution of their
+ * popularity rank. The operations are generated ahead of the measure, so the random number
+ * generation is not timed.
+ */
+class load_generator
+{
+  public:
+  explicit load_generator(load_options options)
+    : m_options{std::move(options)},
+      m_random{m_options.seed},
+      m_zipf{m_options.key_count, m_options.zipf_exponent},
+      m_ranks(m_options.key_count),
+      m_signatures{m_options.signature_mix.begin(), m_options.signature_mix.end()},
+      m_flavours{m_options.flavour_mix.begin(), m_options.flavour_mix.end()}
+  {
+    if(m_options.key_count == 0 || m_options.min_key_length > m_options.max_key_length ||
+      m_options.flavour_mix.size() > flavour_count)
+    {
+      throw std::invalid_argument("invalid load options");
+    }
+
+    std::uniform_int_distribution<size_t> length(m_options.min_key_length, m_options.max_key_length);
+    std::uniform_int_distribution<int> letter('a', 'z');
+
+    // the index is appended so that the keys are distinct
+    for(size_t i = 0; i < m_options.key_count; ++i)
+    {
+      auto suffix = std::to_string(i);
+      auto key    = std::string(std::max(length(m_random), suffix.size()) - suffix.size(), ' ');
+      for(auto& c : key)
+      {
+        c = char(letter(m_random));
+      }
+      m_keys.push_back(key + suffix);
+    }
+
+    std::iota(m_ranks.begin(), m_ranks.end(), uint32_t(0));
+    if(m_options.shuffle_ranks)
+    {
+      std::shuffle(m_ranks.begin(), m_ranks.end(), m_random);
+    }
+  }
+
+  // the keys, in registration order
+  const std::vector<std::string>& keys() const
+  {
+    return m_keys;
+  }
+
+  const load_options& options() const
+  {
+    return m_options;
+  }
+
+  // share of the operations on the count most popular keys
+  double head(size_t count) const
+  {
+    return m_zipf.head(count);
+  }
+
+  operation next()
+  {
+    operation op;
+    op.key       = m_ranks[m_zipf(m_random)];
+    op.signature = uint16_t(m_signatures(m_random));
+    op.call      = flavour(m_flavours(m_random));
+    op.write     = std::bernoulli_distribution(m_options.write_ratio)(m_random);
+    return op;
+  }
+
+  std::vector<operation> operations(size_t count)
+  {
+    std::vector<operation> result(count);
+    std::generate(result.begin(), result.end(),
+      [this]
+      {
+        return next();
+      });
+    return result;
+  }
+
+  private:
+  load_options m_options;
+  std::mt19937_64 m_random;
+  zipf_distribution m_zipf;
+  std::vector<uint32_t> m_ranks; // key of each popularity rank
+  std::discrete_distribution<size_t> m_signatures;
+  std::discrete_distribution<size_t> m_flavours;
+  std::vector<std::string> m_keys;
+};
+
+} // namespace bench
+
+#endif // STATIC_FACTORY_LOAD_GENERATOR_H
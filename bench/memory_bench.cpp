@@ -0,0 +1,115 @@
+//
+// footprint of large registries before and after compact(), and the cost of the calls on them:
+// keys registered with types and with capturing functions, for the linear and hashed storages
+//
+
+#include "bench.hpp"
+
+#include <static_factory.hpp>
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+struct Shape
+{
+  virtual ~Shape() = default;
+
+  virtual size_t sides() const = 0;
+};
+
+struct Polygon : Shape
+{
+  explicit Polygon(size_t s) : m_sides{s}
+  {
+  }
+
+  size_t sides() const override
+  {
+    return m_sides;
+  }
+
+  size_t m_sides;
+};
+
+struct Square : Shape
+{
+  size_t sides() const override
+  {
+    return 4;
+  }
+};
+
+struct hashed_policies : factory_policies::defaults
+{
+  using storage = factory_policies::hashed_storage;
+  using locking = factory_policies::shared_mutex_locking;
+};
+
+void print(const char* name, const registry_usage& usage)
+{
+  std::printf("%-40s %7zu keys %8zu functions %10zu bytes %10zu state bytes\n",
+    name,
+    usage.keys,
+    usage.functions,
+    usage.bytes,
+    usage.state_bytes);
+}
+
+template <typename Policies>
+void run(const char* config, size_t key_count)
+{
+  using factory = static_factory<Shape, std::string, Policies>;
+
+  std::vector<std::string> keys;
+  for(size_t i = 0; i < key_count; ++i)
+  {
+    auto key = "Polygon" + std::to_string(i);
+    factory::register_function(key,
+      [sides = i % 16 + 3]
+      {
+        return std::make_unique<Polygon>(sides);
+      });
+    keys.push_back(key);
+
+    key = "Square" + std::to_string(i);
+    factory::template register_type<Square>(key);
+    keys.push_back(key);
+  }
+
+  char name[128];
+  std::snprintf(name, sizeof(name), "%s %zu keys", config, keys.size());
+  print(name, factory::memory_usage());
+
+  auto measure = [&](const char* phase)
+  {
+    char label[128];
+    std::snprintf(label, sizeof(label), "  make_unique %s", phase);
+    bench::run(label,
+      size_t(1) << 21,
+      [&](size_t i)
+      {
+        // a stride across the keys, so that the records and the states are not all cached
+        bench::do_not_optimize(factory::make_unique(keys[(i * 7919) % keys.size()])->sides());
+      });
+  };
+
+  measure("before compact");
+
+  factory::seal();
+  print("  sealed", factory::memory_usage());
+
+  measure("after compact");
+}
+
+} // namespace
+
+int main()
+{
+  run<factory_policies::defaults>("linear", 512);
+  run<hashed_policies>("hashed", 1 << 14);
+}
@@ -0,0 +1,78 @@
+#
+# build time of N translation units using static_factory, including the header or importing the
+# module. the translation units are built in a generated project, after the module itself.
+#
+# cmake -DGENERATOR=Ninja -DCOMPILER=c++ -DSOURCE_DIR=<static_factory> -DOUTPUT_DIR=out -DCOUNT=100 -P module_bench.cmake
+#
+
+foreach(var GENERATOR COMPILER SOURCE_DIR OUTPUT_DIR COUNT)
+  if(NOT DEFINED ${var})
+    message(FATAL_ERROR "module_bench: ${var} is not defined")
+  endif()
+endforeach()
+
+include(${CMAKE_CURRENT_LIST_DIR}/bench_utils.cmake)
+
+file(MAKE_DIRECTORY ${OUTPUT_DIR}/src)
+
+set(project "cmake_minimum_required(VERSION 3.28)\n\nproject(static_factory_module_bench CXX)\n\n")
+string(APPEND project "set(BUILD_MODULE ON)\nadd_subdirectory(${SOURCE_DIR} static_factory)\n\n")
+
+set(header_sources "")
+set(module_sources "")
+
+math(EXPR last "${COUNT} - 1")
+foreach(i RANGE ${last})
+  set(body "namespace\n{\nstruct Base\n{\n  virtual ~Base() = default;\n};\n\nstruct Type : Base\n{\n};\n} // namespace\n\n")
+  string(APPEND body "bool make_${i}()\n{\n  static_factory<Base>::register_type<Type>(\"Type\");\n  return static_factory<Base>::make_unique(\"Type\") != nullptr;\n}\n")
+
+  file(WRITE ${OUTPUT_DIR}/src/header_${i}.cpp "#include <static_factory.hpp>\n\n${body}")
+  file(WRITE ${OUTPUT_DIR}/src/module_${i}.cpp "import static_factory;\n\n${body}")
+
+  string(APPEND header_sources " src/header_${i}.cpp")
+  string(APPEND module_sources " src/module_${i}.cpp")
+endforeach()
+
+string(APPEND project "add_library(header_tus OBJECT${header_sources})\ntarget_link_libraries(header_tus PRIVATE static_factory)\n\n")
+string(APPEND project "add_library(module_tus OBJECT${module_sources})\ntarget_link_libraries(module_tus PRIVATE static_factory_module)\n")
+
+file(WRITE ${OUTPUT_DIR}/CMakeLists.txt "${project}")
+
+execute_process(
+  COMMAND ${CMAKE_COMMAND} -S ${OUTPUT_DIR} -B ${OUTPUT_DIR}/build -G ${GENERATOR}
+    -DCMAKE_CXX_COMPILER=${COMPILER} -DCMAKE_BUILD_TYPE=Release
+  RESULT_VARIABLE result
+  OUTPUT_QUIET)
+if(NOT result EQUAL 0)
+  message(FATAL_ERROR "module_bench: configuration failed")
+endif()
+
+# the module interface is built once per project, it is not part of the measured builds
+execute_process(
+  COMMAND ${CMAKE_COMMAND} --build ${OUTPUT_DIR}/build --target static_factory_module
+  RESULT_VARIABLE result
+  OUTPUT_QUIET)
+if(NOT result EQUAL 0)
+  message(FATAL_ERROR "module_bench: build of the module failed")
+endif()
+
+message(STATUS "translation units  header (s)  module (s)")
+
+set(line "${COUNT}")
+foreach(target header_tus module_tus)
+  bench_now(start)
+  execute_process(
+    COMMAND ${CMAKE_COMMAND} --build ${OUTPUT_DIR}/build --target ${target}
+    RESULT_VARIABLE result
+    OUTPUT_QUIET)
+  bench_now(stop)
+
+  if(NOT result EQUAL 0)
+    message(FATAL_ERROR "module_bench: build of ${target} failed")
+  endif()
+
+  bench_elapsed(${start} ${stop} elapsed)
+  string(APPEND line "  ${elapsed}")
+endforeach()
+
+message(STATUS "${line}")
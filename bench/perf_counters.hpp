@@ -0,0 +1,206 @@
+#ifndef STATIC_FACTORY_PERF_COUNTERS_H
+#define STATIC_FACTORY_PERF_COUNTERS_H
+
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <optional>
+#include <utility>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace bench
+{
+
+// hardware counters measured around a benchmark
+enum class counter : size_t
+{
+  cycles,
+  instructions,
+  l1d_misses,
+  llc_misses,
+  branch_misses
+};
+
+inline constexpr size_t counter_count = 5;
+
+// counter values, nullopt for the counters the cpu or the kernel does not provide
+using counter_values = std::array<std::optional<double>, counter_count>;
+
+/**
+ * \brief The perf_counters class reads the hardware counters of the calling thread with perf_event_open.
+ *
+ * Enabled by setting STATIC_FACTORY_BENCH_COUNTERS in the environment. The counters are opened
+ * as one group, so they are measured over the same instructions, and scaled when the kernel
+ * multiplexes them. The counters that cannot be opened, e.g. with perf_event_paranoid > 2 or
+ * in a virtual machine, are reported as missing.
+ */
+class perf_counters
+{
+  public:
+  perf_counters()
+  {
+#if defined(__linux__)
+    if(!std::getenv("STATIC_FACTORY_BENCH_COUNTERS"))
+    {
+      return;
+    }
+
+    auto cache = [](uint64_t cache, uint64_t result)
+    {
+      return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (result << 16);
+    };
+
+    const std::array<std::pair<uint32_t, uint64_t>, counter_count> events = {{
+      {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+      {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+      {PERF_TYPE_HW_CACHE, cache(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_RESULT_MISS)},
+      {PERF_TYPE_HW_CACHE, cache(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_RESULT_MISS)},
+      {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    }};
+
+    for(size_t i = 0; i < counter_count; ++i)
+    {
+      perf_event_attr attr;
+      std::memset(&attr, 0, sizeof(attr));
+      attr.size           = sizeof(attr);
+      attr.type           = events[i].first;
+      attr.config         = events[i].second;
+      attr.disabled       = m_leader < 0;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv     = 1;
+      attr.read_format    = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+      int fd = int(::syscall(SYS_perf_event_open, &attr, 0, -1, m_leader, 0));
+      if(fd < 0)
+      {
+        continue;
+      }
+      if(m_leader < 0)
+      {
+        m_leader = fd;
+      }
+      m_fds[i]   = fd;
+      m_slots[i] = m_opened++;
+    }
+
+    static bool warned = false;
+    if(!enabled() && !std::exchange(warned, true))
+    {
+      std::fprintf(stderr, "perf_event_open: %s, hardware counters disabled\n", std::strerror(errno));
+    }
+#endif
+  }
+
+  perf_counters(const perf_counters&)            = delete;
+  perf_counters& operator=(const perf_counters&) = delete;
+
+  ~perf_counters()
+  {
+#if defined(__linux__)
+    for(int fd : m_fds)
+    {
+      if(fd >= 0)
+      {
+        ::close(fd);
+      }
+    }
+#endif
+  }
+
+  // true if at least one counter could be opened
+  bool enabled() const
+  {
+    return m_leader >= 0;
+  }
+
+  void start()
+  {
+#if defined(__linux__)
+    if(enabled())
+    {
+      ::ioctl(m_leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+      ::ioctl(m_leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+#endif
+  }
+
+  //
+  // stop the counters and return their values since start(), divided by operations
+  //
+  counter_values stop(size_t operations)
+  {
+    counter_values values;
+#if defined(__linux__)
+    if(!enabled())
+    {
+      return values;
+    }
+
+    ::ioctl(m_leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+    // nr, time_enabled, time_running, then one value per opened counter
+    std::array<uint64_t, 3 + counter_count> buffer{};
+    if(::read(m_leader, buffer.data(), sizeof(buffer)) < ssize_t(3 * sizeof(uint64_t)) || buffer[2] == 0)
+    {
+      return values;
+    }
+
+    double scale = double(buffer[1]) / double(buffer[2]) / double(operations);
+    for(size_t i = 0; i < counter_count; ++i)
+    {
+      if(m_fds[i] >= 0 && m_slots[i] < buffer[0])
+      {
+        values[i] = double(buffer[3 + m_slots[i]]) * scale;
+      }
+    }
+#endif
+    return values;
+  }
+
+  //
+  // print the values per operation on one line
+  //
+  static void print(const counter_values& values)
+  {
+    static const char* names[counter_count] = {"cycles", "instr", "L1d miss", "LLC miss", "br miss"};
+
+    std::printf("%40s", "");
+    for(size_t i = 0; i < counter_count; ++i)
+    {
+      if(values[i])
+      {
+        std::printf(" %s %.2f", names[i], *values[i]);
+      }
+      else
+      {
+        std::printf(" %s n/a", names[i]);
+      }
+    }
+    auto& cycles       = values[size_t(counter::cycles)];
+    auto& instructions = values[size_t(counter::instructions)];
+    if(cycles && instructions && *cycles > 0)
+    {
+      std::printf("  IPC %.2f", *instructions / *cycles);
+    }
+    std::printf(" /op\n");
+  }
+
+  private:
+  int m_leader = -1;
+  size_t m_opened = 0;
+  std::array<int, counter_count> m_fds = {-1, -1, -1, -1, -1};
+  std::array<size_t, counter_count> m_slots{};
+};
+
+} // namespace bench
+
+#endif // STATIC_FACTORY_PERF_COUNTERS_H
@@ -0,0 +1,150 @@
+//
+// capture the calls of a few threads making objects of skewed keys, then replay the capture
+// against factories of other storage and locking policies, at full speed and at the original pacing
+//
+
+#include <static_factory_capture.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+struct Shape
+{
+  virtual ~Shape() = default;
+
+  virtual int sides() const = 0;
+};
+
+template <int Sides>
+struct Polygon : Shape
+{
+  int sides() const override
+  {
+    return Sides;
+  }
+};
+
+struct capture_policies : factory_policies::defaults
+{
+  using instrumentation = factory_policies::capture_instrumentation;
+};
+
+struct hashed_policies : factory_policies::defaults
+{
+  using storage = factory_policies::hashed_storage;
+  using locking = factory_policies::shared_mutex_locking;
+};
+
+struct single_threaded_policies : factory_policies::defaults
+{
+  using locking = factory_policies::no_locking;
+};
+
+constexpr size_t key_count = 256;
+
+template <typename Factory>
+void register_keys()
+{
+  for(size_t i = 0; i < key_count; ++i)
+  {
+    Factory::template register_type<Polygon<3>>("Shape" + std::to_string(i));
+  }
+}
+
+template <typename Factory>
+void replay(const char* name, const workload_log& log, bool original_pacing)
+{
+  register_keys<Factory>();
+
+  workload_replay<Factory> replay(log);
+  replay.template bind<std::unique_ptr<Shape>>();
+  replay.template bind<std::shared_ptr<Shape>>();
+
+  auto report = replay.run({.original_pacing = original_pacing});
+
+  std::printf("%-40s %10.0f calls/s  p50 %6llu ns  p99 %6llu ns  p99.9 %7llu ns  max %8llu ns\n",
+    name,
+    report.calls_per_second,
+    static_cast<unsigned long long>(report.p50),
+    static_cast<unsigned long long>(report.p99),
+    static_cast<unsigned long long>(report.p999),
+    static_cast<unsigned long long>(report.max));
+}
+
+} // namespace
+
+int main()
+{
+  constexpr size_t threads = 4;
+  constexpr size_t calls   = 250000;
+
+  using captured = static_factory<Shape, std::string, capture_policies>;
+  register_keys<captured>();
+
+  const std::string path = "static_factory_replay_bench.cap";
+
+  // key i is made about 1 / (i + 1) as often as key 0, one call in four makes a shared pointer
+  std::vector<std::string> keys;
+  for(size_t i = 0; i < key_count; ++i)
+  {
+    for(size_t n = 0; n < key_count / (i + 1); ++n)
+    {
+      keys.push_back("Shape" + std::to_string(i));
+    }
+  }
+
+  workload_capture::start(path);
+  {
+    std::vector<std::jthread> workers;
+    for(size_t t = 0; t < threads; ++t)
+    {
+      workers.emplace_back(
+        [&, t]
+        {
+          for(size_t i = 0; i < calls; ++i)
+          {
+            auto& key = keys[(i * 2654435761u + t) % keys.size()];
+            if(i % 4 == 0)
+            {
+              captured::make_shared(key);
+            }
+            else
+            {
+              captured::make_unique(key);
+            }
+          }
+        });
+    }
+  }
+  auto captured_calls = workload_capture::stop();
+
+  auto log = workload_log::load(path);
+  std::printf("captured %zu calls of %zu threads\n", captured_calls, threads);
+
+  replay<static_factory<Shape>>("linear storage, mutex", log, false);
+  replay<static_factory<Shape, std::string, hashed_policies>>("hashed storage, shared_mutex", log, false);
+
+  // the calls of the first thread only, without locking
+  workload_log first_thread{log.signatures, {}};
+  std::copy_if(log.records.begin(),
+    log.records.end(),
+    std::back_inserter(first_thread.records),
+    [](const detail::capture_record& record)
+    {
+      return record.thread == 0;
+    });
+  replay<static_factory<Shape, std::string, single_threaded_policies>>("linear storage, no locking, 1 thread",
+    first_thread,
+    false);
+
+  replay<static_factory<Shape, std::string, hashed_policies>>("hashed storage, original pacing", log, true);
+
+  std::remove(path.c_str());
+}
@@ -0,0 +1,181 @@
+//
+// overhead of the instrumentation policies on make_unique: none, sampling at several periods and
+// full tracing, on one thread and on several threads, and of the object accounting
+//
+
+#include "bench.hpp"
+
+#include <static_factory_accounting.hpp>
+#include <static_factory_sampling.hpp>
+
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+struct Shape
+{
+  virtual ~Shape() = default;
+
+  virtual int sides() const = 0;
+};
+
+struct Square : Shape
+{
+  int sides() const override
+  {
+    return 4;
+  }
+};
+
+struct hashed_policies : factory_policies::defaults
+{
+  using storage = factory_policies::hashed_storage;
+  using locking = factory_policies::shared_mutex_locking;
+};
+
+struct sampling_policies : hashed_policies
+{
+  using instrumentation = factory_policies::sampling_instrumentation;
+};
+
+struct trace_policies : hashed_policies
+{
+  using instrumentation = factory_policies::trace_instrumentation;
+};
+
+constexpr size_t key_count = 64;
+
+std::vector<std::string> g_keys;
+
+template <typename Factory>
+void register_keys()
+{
+  for(auto& key : g_keys)
+  {
+    Factory::template register_type<Square>(key);
+  }
+}
+
+template <typename Factory>
+double measure(const char* name, size_t iterations)
+{
+  return bench::run(name,
+    iterations,
+    [](size_t i)
+    {
+      bench::do_not_optimize(Factory::make_unique(g_keys[i % key_count]));
+    });
+}
+
+// ns per call per thread, with threads threads making objects concurrently
+template <typename Factory>
+void measure_threads(const char* name, size_t threads, size_t iterations)
+{
+  std::vector<std::thread> workers;
+  std::vector<double> seconds(threads);
+  for(size_t t = 0; t < threads; ++t)
+  {
+    workers.emplace_back(
+      [&, t]
+      {
+        auto start = std::chrono::steady_clock::now();
+        for(size_t i = 0; i < iterations; ++i)
+        {
+          bench::do_not_optimize(Factory::make_unique(g_keys[(i + t) % key_count]));
+        }
+        seconds[t] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      });
+  }
+  for(auto& worker : workers)
+  {
+    worker.join();
+  }
+
+  double total = 0;
+  for(double s : seconds)
+  {
+    total += s;
+  }
+  std::printf("%-40s %10.1f ns/op per thread\n", name, total * 1e9 / double(threads * iterations));
+}
+
+} // namespace
+
+int main()
+{
+  constexpr size_t iterations = 1 << 22;
+
+  for(size_t i = 0; i < key_count; ++i)
+  {
+    g_keys.push_back("Square" + std::to_string(i));
+  }
+
+  using plain    = static_factory<Shape, std::string, hashed_policies>;
+  using sampling = static_factory<Shape, std::string, sampling_policies>;
+  using traced   = static_factory<Shape, std::string, trace_policies>;
+
+  register_keys<plain>();
+  register_keys<sampling>();
+  register_keys<traced>();
+
+  double base = measure<plain>("no_instrumentation", iterations);
+
+  for(uint32_t period : {1u, 16u, 1024u, 65536u})
+  {
+    factory_sampler::set_period(period);
+    factory_sampler::reset();
+
+    char name[64];
+    std::snprintf(name, sizeof(name), "sampling 1/%u", period);
+    double seconds = measure<sampling>(name, iterations);
+
+    auto stats = factory_sampler::snapshot();
+    std::printf("%40s overhead %+.1f ns/op, %llu sampled, p50 < %llu ns, p99 < %llu ns\n",
+      "",
+      (seconds - base) * 1e9 / double(iterations),
+      static_cast<unsigned long long>(stats.sampled),
+      static_cast<unsigned long long>(stats.percentile(0.5)),
+      static_cast<unsigned long long>(stats.percentile(0.99)));
+  }
+
+  measure<traced>("trace_instrumentation inactive", iterations);
+  factory_tracer::start(1 << 10);
+  measure<traced>("trace_instrumentation active", iterations);
+  factory_tracer::stop();
+
+  using accounted = accounted_factory<plain>;
+  for(auto& key : g_keys)
+  {
+    accounted::register_type<Square>(key);
+  }
+
+  bench::run("accounting disabled",
+    iterations,
+    [](size_t i)
+    {
+      bench::do_not_optimize(accounted::make_unique(g_keys[i % key_count]));
+    });
+  accounted::enable();
+  bench::run("accounting enabled",
+    iterations,
+    [](size_t i)
+    {
+      bench::do_not_optimize(accounted::make_unique(g_keys[i % key_count]));
+    });
+  accounted::enable(false);
+
+  factory_sampler::set_period(1024);
+  std::printf("\n");
+  for(size_t threads : {1, 4})
+  {
+    char name[64];
+    std::snprintf(name, sizeof(name), "no_instrumentation %zu threads", threads);
+    measure_threads<plain>(name, threads, iterations / 4);
+    std::snprintf(name, sizeof(name), "sampling 1/1024 %zu threads", threads);
+    measure_threads<sampling>(name, threads, iterations / 4);
+  }
+}
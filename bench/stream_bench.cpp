@@ -0,0 +1,118 @@
+//
+// records per second of a record_stream reading a mapped file and a pipe
+//
+
+#include <static_factory_stream.hpp>
+
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include <unistd.h>
+
+namespace
+{
+
+struct Record
+{
+  virtual ~Record() = default;
+
+  virtual size_t size() const = 0;
+};
+
+struct Sample : Record
+{
+  explicit Sample(std::span<const std::byte> bytes) : payload{bytes}
+  {
+  }
+
+  size_t size() const override
+  {
+    return payload.size();
+  }
+
+  std::span<const std::byte> payload;
+};
+
+using factory = static_factory<Record>;
+
+std::string make_records(size_t count, size_t payload_size)
+{
+  const char* keys[] = {"Sample0", "Sample1", "Sample2", "Sample3"};
+
+  std::string records;
+  for(size_t i = 0; i < count; ++i)
+  {
+    std::string_view key = keys[i % 4];
+    detail::record_header header{uint32_t(key.size()), uint32_t(payload_size)};
+    records.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    records.append(key);
+    records.append(payload_size, 'x');
+  }
+  return records;
+}
+
+void consume(const char* name, int fd)
+{
+  record_stream<factory> stream(fd);
+  record_stream<factory>::batch batch;
+  while(stream.next(batch))
+  {
+  }
+
+  std::printf("%-20s %10zu records %14.0f records/s\n", name, stream.records(), stream.records_per_second());
+}
+
+} // namespace
+
+int main()
+{
+  constexpr size_t record_count = 4'000'000;
+  constexpr size_t payload_size = 64;
+
+  for(auto key : {"Sample0", "Sample1", "Sample2", "Sample3"})
+  {
+    factory::register_deserializer<Sample>(key);
+  }
+
+  auto records = make_records(record_count, payload_size);
+
+  {
+    auto file = std::tmpfile();
+    std::fwrite(records.data(), 1, records.size(), file);
+    std::fflush(file);
+    consume("mapped file", fileno(file));
+    std::fclose(file);
+  }
+
+  {
+    int fds[2];
+    if(::pipe(fds) != 0)
+    {
+      return 1;
+    }
+
+    std::thread writer(
+      [&]
+      {
+        for(size_t offset = 0; offset < records.size();)
+        {
+          auto count = ::write(fds[1], records.data() + offset, records.size() - offset);
+          if(count <= 0)
+          {
+            break;
+          }
+          offset += size_t(count);
+        }
+        ::close(fds[1]);
+      });
+
+    consume("pipe", fds[0]);
+
+    writer.join();
+    ::close(fds[0]);
+  }
+
+  return 0;
+}
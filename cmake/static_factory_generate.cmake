@@ -0,0 +1,35 @@
+#
+# static_factory_generate(<target> <manifest>)
+#
+# Generates, at build time, a generated_factory registry header from the manifest and adds it to
+# the target. The header is named after the manifest file (pets.txt -> pets.hpp) and is placed in
+# a directory added to the include directories of the target. The include directives of the
+# manifest are resolved from the include directories of the target and the manifest directory.
+# The header names the manifest by its path relative to the top source directory.
+#
+function(static_factory_generate target manifest)
+  if(NOT TARGET static_factory_generator)
+    add_executable(static_factory_generator
+      ${CMAKE_CURRENT_FUNCTION_LIST_DIR}/../tools/static_factory_generator.cpp)
+    target_link_libraries(static_factory_generator PRIVATE static_factory)
+  endif()
+
+  get_filename_component(manifest_path ${manifest} ABSOLUTE)
+  get_filename_component(manifest_name ${manifest} NAME_WE)
+  get_filename_component(manifest_dir ${manifest_path} DIRECTORY)
+
+  set(output_dir ${CMAKE_CURRENT_BINARY_DIR}/static_factory_generated/${target})
+  set(output ${output_dir}/${manifest_name}.hpp)
+
+  add_custom_command(
+    OUTPUT ${output}
+    COMMAND ${CMAKE_COMMAND} -E make_directory ${output_dir}
+    COMMAND static_factory_generator ${manifest_path} ${output} ${CMAKE_SOURCE_DIR}
+    DEPENDS ${manifest_path} static_factory_generator
+    COMMENT "Generating static_factory registry ${manifest_name}.hpp"
+    VERBATIM
+  )
+
+  target_sources(${target} PRIVATE ${output})
+  target_include_directories(${target} PRIVATE ${output_dir} ${manifest_dir})
+endfunction()
@@ -1,15 +1,49 @@
 #ifndef STATIC_FACTORY_H
 #define STATIC_FACTORY_H
 
+#include "static_factory_hash.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
 #include <exception>
 #include <functional>
 #include <memory>
 #include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <span>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <tuple>
 #include <type_traits>
+#include <typeindex>
 #include <typeinfo>
+#include <unordered_map>
+#include <variant>
 #include <vector>
 
+#if defined(__GNUG__)
+#include <cxxabi.h>
+#endif
+
+/**
+ * \brief The size of the registry of a static_factory and the bytes it allocates.
+ */
+struct registry_usage
+{
+  size_t keys        = 0;
+  size_t functions   = 0; // registered (key, signature) pairs
+  size_t signatures  = 0; // signatures registered or looked up
+  size_t states      = 0; // functions with a state: a callable or a deserializer, allocated apart
+  size_t bytes       = 0; // the index, the signatures and the records, without the states
+  size_t state_bytes = 0; // the distinct states, computed by static_factory::memory_usage() only
+};
+
 namespace detail
 {
 
@@ -45,6 +79,91 @@ struct get_template_arg_type_of<C<Args...>>
   };
 };
 
+template <typename T, typename Variant>
+struct variant_index;
+
+template <typename T, typename... Alternatives>
+struct variant_index<T, std::variant<Alternatives...>>
+{
+  private:
+  static constexpr std::array<bool, sizeof...(Alternatives)> matches = {
+    std::is_same_v<T, Alternatives>...};
+
+  static constexpr size_t find()
+  {
+    size_t index = sizeof...(Alternatives);
+    for(size_t i = 0; i < matches.size(); ++i)
+    {
+      if(matches[i])
+      {
+        if(index != sizeof...(Alternatives))
+        {
+          return sizeof...(Alternatives); // ambiguous alternative
+        }
+        index = i;
+      }
+    }
+    return index;
+  }
+
+  public:
+  static constexpr size_t value = find();
+};
+
+// index of T in Variant, std::variant_npos if T is not a unique alternative of Variant
+template <typename T, typename Variant>
+constexpr size_t variant_index_v = variant_index<T, Variant>::value < std::variant_size_v<Variant>
+  ? variant_index<T, Variant>::value
+  : std::variant_npos;
+
+// compile time table of constructors, one per alternative of Variant, nullptr for the
+// alternatives that are not constructible from Args
+template <typename Variant, typename... Args>
+struct variant_constructor_table;
+
+template <typename... Alternatives, typename... Args>
+struct variant_constructor_table<std::variant<Alternatives...>, Args...>
+{
+  using variant_type = std::variant<Alternatives...>;
+  using constructor  = variant_type (*)(Args&&...);
+
+  template <typename Alternative>
+  static constexpr constructor make_constructor()
+  {
+    if constexpr(std::is_constructible_v<Alternative, Args&&...>)
+    {
+      return [](Args&&... args)
+      {
+        return variant_type(std::in_place_type<Alternative>, std::forward<Args>(args)...);
+      };
+    }
+    else
+    {
+      return nullptr;
+    }
+  }
+
+  static constexpr std::array<constructor, sizeof...(Alternatives)> value = {
+    make_constructor<Alternatives>()...};
+};
+
+// string literal usable as a non-type template parameter: make<"key">()
+template <size_t N>
+struct fixed_string
+{
+  char data[N]{};
+
+  constexpr fixed_string(const char (&str)[N])
+  {
+    std::copy_n(str, N, data);
+  }
+
+  constexpr std::string_view view() const
+  {
+    return std::string_view(data, N - 1);
+  }
+};
+
 template <typename Key, typename Value>
 class unordered_flat_map
 {
@@ -93,6 +212,15 @@ class unordered_flat_map
     }
   }
 
+  void erase(const key_type& key)
+  {
+    auto it = find(key);
+    if(it != m_data.end())
+    {
+      m_data.erase(it);
+    }
+  }
+
   auto find(const key_type& key)
   {
     return std::find_if(m_data.begin(),
@@ -112,471 +240,2719 @@ class unordered_flat_map
   {
     return m_data.end();
   }
-};
-
-} // namespace detail
 
-/**
- * \brief The static_factory class provides a static factory pattern implementation.
- *
- * The static_factory class allows registration of types and functions, and provides
- * methods to create instances of registered types. It supports creating instances
- * as BaseType, raw pointers, shared pointers, and unique pointers.
- *
- * \tparam BaseType The base type of the registered types.
- * \tparam KeyType The type of the key used for registration. (default is std::string)
- */
-template <typename BaseType, typename KeyType = std::string>
-class static_factory
-{
-  public:
-  using base_type = BaseType;
-  using key_type  = KeyType;
+  size_t size() const
+  {
+    return m_data.size();
+  }
 
-  template <typename Func>
-  static void register_function(const key_type& key, Func&& func)
+  void shrink_to_fit()
   {
-    register_function_impl(key, std::function(std::forward<Func>(func)));
+    m_data.shrink_to_fit();
   }
 
-  template <typename ConcreteType, typename... Args>
-  static void register_type(const key_type& key)
+  // bytes allocated by the map, not by its values
+  size_t memory_usage() const
   {
-    static_assert(detail::is_related_v<base_type, ConcreteType>, "Invalid type");
+    return m_data.capacity() * sizeof(m_data[0]);
+  }
+};
 
-    std::lock_guard lock(g_mutex);
+// constant descriptor of a type registered with STATIC_FACTORY_REGISTER.
+// the descriptors of all the translation units are gathered by the linker in one section.
+struct alignas(4 * sizeof(void*)) section_entry
+{
+  const std::type_info* factory;     // typeid of the static_factory the entry belongs to
+  const std::type_info* type;        // typeid of the registered type
+  const char* key;
+  void (*install)(const char* key); // registers the type, the factory mutex is already held
+};
 
-    auto hash = g_hash_function(key);
+#define STATIC_FACTORY_STRINGIFY_IMPL(x) #x
+#define STATIC_FACTORY_STRINGIFY(x) STATIC_FACTORY_STRINGIFY_IMPL(x)
+#define STATIC_FACTORY_CONCAT_IMPL(a, b) a##b
+#define STATIC_FACTORY_CONCAT(a, b) STATIC_FACTORY_CONCAT_IMPL(a, b)
 
-    if constexpr(std::is_convertible_v<ConcreteType, base_type>)
-    {
-      get_registry<base_type, Args...>()[hash] = [](Args&&... args)
-      {
-        return ConcreteType(std::forward<Args>(args)...);
-      };
-    }
-    else if constexpr(std::is_base_of_v<base_type, ConcreteType>)
-    {
-      {
-        get_registry<base_type*, Args...>()[hash] = [](Args&&... args)
-        {
-          return new ConcreteType(std::forward<Args>(args)...);
-        };
-      }
+// strips the optional parentheses around a macro argument naming a type with commas
+template <typename T>
+struct unparenthesize;
 
-      {
-        get_registry<std::shared_ptr<base_type>, Args...>()[hash] = [](Args&&... args)
-        {
-          return std::make_shared<ConcreteType>(std::forward<Args>(args)...);
-        };
-      }
+template <typename T>
+struct unparenthesize<void(T)>
+{
+  using type = T;
+};
 
-      {
-        get_registry<std::unique_ptr<base_type>, Args...>()[hash] = [](Args&&... args)
-        {
-          return std::make_unique<ConcreteType>(std::forward<Args>(args)...);
-        };
-      }
-    }
-    else
-    {
-      static_assert(false, "Invalid type");
-    }
+#define STATIC_FACTORY_UNPARENTHESIZE(T) typename detail::unparenthesize<void(T)>::type
+
+// the symbols that every library keeps its own copy of, on the compilers with a symbol visibility
+#if defined(__GNUC__)
+#define STATIC_FACTORY_HIDDEN __attribute__((visibility("hidden")))
+#else
+#define STATIC_FACTORY_HIDDEN
+#endif
+
+#if defined(__ELF__)
+
+#define STATIC_FACTORY_SECTION_NAME static_factory_registry
+
+// bounds of the section, defined by the linker when at least one entry exists
+extern "C" const section_entry STATIC_FACTORY_CONCAT(__start_, STATIC_FACTORY_SECTION_NAME)[]
+  __attribute__((weak, visibility("hidden")));
+extern "C" const section_entry STATIC_FACTORY_CONCAT(__stop_, STATIC_FACTORY_SECTION_NAME)[]
+  __attribute__((weak, visibility("hidden")));
+
+// hidden: every library sees its own section
+STATIC_FACTORY_HIDDEN inline std::pair<const section_entry*, const section_entry*>
+section_entries()
+{
+  return {STATIC_FACTORY_CONCAT(__start_, STATIC_FACTORY_SECTION_NAME),
+    STATIC_FACTORY_CONCAT(__stop_, STATIC_FACTORY_SECTION_NAME)};
+}
+
+#else
+
+inline std::pair<const section_entry*, const section_entry*> section_entries()
+{
+  return {nullptr, nullptr};
+}
+
+#endif
+
+template <typename Factory, typename ConcreteType, typename... Args>
+struct section_registrar
+{
+  static void install(const char* key)
+  {
+    Factory::template register_type_impl<ConcreteType, Args...>(key);
   }
 
-  template <typename ConcreteType, typename... Args>
-  static void register_type()
+  // used where the linker does not gather the section: register at static initialization
+  explicit section_registrar(const char* key)
   {
-    register_type<ConcreteType, Args...>(typeid(ConcreteType).hash_code());
+    Factory::template register_type<ConcreteType, Args...>(key);
   }
+};
 
-  //
-  // try to make instance of base_type using the key and args
-  // throws std::runtime_error if no valid registry is found
-  //
-  template <typename... Args>
-  static base_type make(const key_type& key, Args&&... args)
+//
+// install the entries of Factory found in the section of the calling library, once per library.
+// lock returns the write lock of the factory, taken before the first install.
+// hidden: every library keeps its own copy, and so its own flag and its own section
+//
+template <typename Factory, typename Lock>
+STATIC_FACTORY_HIDDEN void load_section_entries(Lock lock)
+{
+  static std::atomic<bool> loaded = false;
+
+  if(loaded.load(std::memory_order_acquire))
   {
-    std::lock_guard lock(g_mutex);
+    return;
+  }
 
-    auto hash = g_hash_function(key);
+  auto guard = lock();
 
-    auto it = get_registry<base_type, Args...>().find(hash);
+  if(loaded.load(std::memory_order_relaxed))
+  {
+    return;
+  }
 
-    if(it == get_registry<base_type, Args...>().end())
+  auto [begin, end] = section_entries();
+  for(auto entry = begin; entry != end; ++entry)
+  {
+    if(*entry->factory == typeid(Factory))
     {
-      throw std::runtime_error("Registry not found");
+      entry->install(entry->key);
     }
+  }
 
-    return it->second(std::forward<Args>(args)...);
-  };
+  loaded.store(true, std::memory_order_release);
+}
 
-  //
-  // try to make instance of base_type using the resgistered ConcreteType
-  // throws std::runtime_error if no valid registry is found
-  //
-  template <typename ConcreteType, typename... Args>
-    requires(std::is_convertible_v<ConcreteType, base_type>)
-  static base_type make(Args&&... args)
-  {
-    std::lock_guard lock(g_mutex);
+// unordered_flat_map with a hash index: constant time lookups, iteration in insertion order
+template <typename Key, typename Value>
+class hashed_flat_map
+{
+  public:
+  using value_type = Value;
+  using key_type   = Key;
 
-    auto hash = typeid(ConcreteType).hash_code();
+  private:
+  std::vector<std::pair<key_type, value_type>> m_data;
+  std::unordered_map<key_type, size_t> m_index;
 
-    auto it = get_registry<base_type, Args...>().find(hash);
+  public:
+  void insert(const key_type& key, const value_type& value)
+  {
+    (*this)[key] = value;
+  }
 
-    if(it == get_registry<base_type, Args...>().end())
+  value_type& operator[](const key_type& key)
+  {
+    auto [it, inserted] = m_index.try_emplace(key, m_data.size());
+    if(inserted)
     {
-      throw std::runtime_error("Registry not found");
+      m_data.emplace_back(key, value_type());
     }
-
-    return it->second(std::forward<Args>(args)...);
+    return m_data[it->second].second;
   }
 
-  //
-  // loop through all the registered keys and try to make instance of base_type using the provided args
-  // throws std::runtime_error if no valid registry is found
-  //
-  template <typename... Args>
-  static base_type try_make(Args&&... args)
+  void erase(const key_type& key)
   {
-    std::lock_guard lock(g_mutex);
-
-    std::exception_ptr eptr;
-    for(auto&& [_, func] : get_registry<base_type, Args...>())
+    auto it = m_index.find(key);
+    if(it == m_index.end())
     {
-      try
-      {
-        return func(std::forward<Args>(args)...);
-      }
-      catch(...)
-      {
-        eptr = std::current_exception();
-      }
+      return;
     }
 
-    if(eptr)
-    {
-      std::rethrow_exception(eptr);
-    }
-    else
+    auto position = it->second;
+    m_index.erase(it);
+    m_data.erase(m_data.begin() + position);
+
+    for(auto& [_, index] : m_index)
     {
-      if constexpr(std::is_default_constructible_v<base_type>)
-      {
-        return base_type();
-      }
-      else
+      if(index > position)
       {
-        throw std::runtime_error("no valid registery is found");
+        --index;
       }
     }
   }
 
-  //
-  // make raw ptr
-  //
-
-  //
-  // try to make a raw pointer of base_type using the key and args
-  // returns nullptr if no valid registry is found
-  //
-  template <typename... Args>
-  static base_type* make_ptr(const key_type& key, Args&&... args)
+  auto find(const key_type& key)
   {
-    std::lock_guard lock(g_mutex);
-
-    auto hash = g_hash_function(key);
+    auto it = m_index.find(key);
+    return it == m_index.end() ? m_data.end() : m_data.begin() + it->second;
+  }
 
-    auto it = get_registry<base_type*, Args...>().find(hash);
+  auto begin()
+  {
+    return m_data.begin();
+  }
 
-    if(it == get_registry<base_type*, Args...>().end())
-    {
-      throw std::runtime_error("Registry not found");
-    }
+  auto end()
+  {
+    return m_data.end();
+  }
 
-    return it->second(std::forward<Args>(args)...);
+  size_t size() const
+  {
+    return m_data.size();
   }
 
-  //
-  // try to make a raw pointer using ConcreteType and cast it to ConcreteType*
-  // returns nullptr if no valid registry is found
-  //
-  template <typename ConcreteType, typename... Args>
-  static ConcreteType* make_ptr(Args&&... args)
+  void shrink_to_fit()
   {
-    std::lock_guard lock(g_mutex);
+    m_data.shrink_to_fit();
+    m_index.rehash(0);
+  }
 
-    auto hash = typeid(ConcreteType).hash_code();
+  // bytes allocated by the map, not by its values. the nodes of the index are estimated as
+  // their value and a next pointer
+  size_t memory_usage() const
+  {
+    return m_data.capacity() * sizeof(m_data[0]) + m_index.bucket_count() * sizeof(void*) +
+           m_index.size() * (sizeof(typename decltype(m_index)::value_type) + sizeof(void*));
+  }
+};
 
-    auto it = get_registry<base_type*, Args...>().find(hash);
+// the operations on the state of a registered function, to pack the states in one allocation
+struct state_ops
+{
+  size_t size;
+  size_t align;
+  void (*move)(void* from, void* to); // move constructs at to, nullptr if it may throw or is pinned
+  void (*destroy)(void* state);
+};
 
-    if(it == get_registry<base_type*, Args...>().end())
-    {
-      throw std::runtime_error("Registry not found");
-    }
+// a state that keeps its own allocation, declaring the member type static_factory_pinned_state:
+// e.g. a state owning a resource that must be released with it, not with the arena of compact()
+template <typename T>
+concept pinned_state = requires { typename T::static_factory_pinned_state; };
 
-    return static_cast<ConcreteType*>(it->second(std::forward<Args>(args)...));
-  }
+template <typename T>
+void move_state(void* from, void* to)
+{
+  ::new(to) T(std::move(*static_cast<T*>(from)));
+}
 
-  //
-  // loop through all the registered keys and try to make a raw pointer of base_type using the provided args
-  // returns nullptr if no valid registry is found
-  //
-  template <typename... Args>
-  static base_type* try_make_ptr(Args&&... args)
-  {
-    std::lock_guard lock(g_mutex);
+template <typename T>
+void destroy_state(void* state)
+{
+  static_cast<T*>(state)->~T();
+}
 
-    std::exception_ptr eptr;
-    for(auto&& [_, func] : get_registry<base_type*, Args...>())
-    {
-      try
-      {
-        auto obj = func(std::forward<Args>(args)...);
-        if(obj)
-        {
-          return obj;
-        }
-      }
-      catch(...)
-      {
-        eptr = std::current_exception();
-      }
-    }
+template <typename T>
+inline constexpr state_ops state_ops_of = {sizeof(T),
+  alignof(T),
+  std::is_nothrow_move_constructible_v<T> && !pinned_state<T> ? &move_state<T> : nullptr,
+  &destroy_state<T>};
+
+// the state of a registered function: the callable given to register_function or register_deserializer
+struct function_state
+{
+  std::shared_ptr<void> object;
+  const state_ops* ops = nullptr;
+};
+
+template <typename T, typename... Args>
+function_state make_state(Args&&... args)
+{
+  return {std::make_shared<T>(std::forward<Args>(args)...), &state_ops_of<T>};
+}
+
+// a registered function with its type erased. the typed wrappers cast thunk back to
+// thunk_type<RetType, Args...> and call it with state, the callable given to register_function
+struct erased_function
+{
+  void (*thunk)() = nullptr;
+  std::shared_ptr<void> state;
+  const state_ops* ops = nullptr; // the operations on state
+};
+
+// value category of an argument given to make
+enum class arg_category : unsigned char
+{
+  lvalue,
+  const_lvalue,
+  rvalue
+};
+
+// an argument given to make, passed by reference to the registered functions
+template <typename T>
+struct arg_ref
+{
+  T* value;
+  arg_category category;
+};
+
+template <typename Arg>
+arg_ref<std::remove_cvref_t<Arg>> make_arg_ref(Arg&& arg)
+{
+  using type = std::remove_reference_t<Arg>;
+
+  return {const_cast<std::remove_cv_t<type>*>(std::addressof(arg)),
+    std::is_rvalue_reference_v<Arg&&> ? arg_category::rvalue
+    : std::is_const_v<type>           ? arg_category::const_lvalue
+                                      : arg_category::lvalue};
+}
+
+// arg forwarded as is, or decayed to a pointer for the arrays and the functions
+template <typename Arg>
+decltype(auto) decay_arg(std::remove_reference_t<Arg>& arg)
+{
+  if constexpr(std::is_same_v<std::remove_cvref_t<Arg>, std::decay_t<Arg>>)
+  {
+    return static_cast<Arg&&>(arg);
+  }
+  else
+  {
+    return std::decay_t<Arg>(arg);
+  }
+}
+
+// a copy of the argument, or the argument moved when it is an rvalue
+template <typename T>
+T copy_or_move(const arg_ref<T>& ref)
+{
+  if(ref.category != arg_category::rvalue)
+  {
+    if constexpr(std::is_copy_constructible_v<T>)
+    {
+      return *ref.value;
+    }
+    else
+    {
+      throw std::runtime_error("Move only argument passed as an lvalue");
+    }
+  }
+  return std::move(*ref.value);
+}
+
+// an argument as declared by a registered function: references are bound to the argument given
+// to make, a by value parameter is copied or moved once. the argument is copied only when its
+// value category cannot bind to the declared reference, the copy lives until the end of the call
+template <typename Arg>
+class forwarded_arg
+{
+  public:
+  using value_type = std::decay_t<Arg>;
+
+  explicit forwarded_arg(const arg_ref<value_type>& ref) : m_ref{ref}
+  {
+  }
+
+  decltype(auto) get()
+  {
+    if constexpr(!std::is_reference_v<Arg>)
+    {
+      return copy_or_move(m_ref);
+    }
+    else if constexpr(std::is_lvalue_reference_v<Arg> && std::is_const_v<std::remove_reference_t<Arg>>)
+    {
+      return static_cast<Arg>(*m_ref.value);
+    }
+    else
+    {
+      const bool binds = std::is_lvalue_reference_v<Arg> ? m_ref.category != arg_category::const_lvalue
+                                                         : m_ref.category == arg_category::rvalue;
+      if(binds)
+      {
+        return static_cast<Arg&&>(*m_ref.value);
+      }
+      return static_cast<Arg&&>(m_copy.emplace(copy_or_move(m_ref)));
+    }
+  }
+
+  private:
+  arg_ref<value_type> m_ref;
+  std::optional<value_type> m_copy;
+};
+
+template <typename RetType, typename... Args>
+using thunk_type = RetType (*)(void*, arg_ref<Args>...);
+
+// true if a function declared void(Params...) can be called with Args by implicit conversions,
+// and Args are not already its exact argument types
+template <typename Signature, typename... Args>
+struct is_viable_signature : std::false_type
+{
+};
+
+template <typename... Params, typename... Args>
+  requires(sizeof...(Params) == sizeof...(Args))
+struct is_viable_signature<void(Params...), Args...>
+  : std::bool_constant<(std::is_convertible_v<Args&&, std::decay_t<Params>> && ...) &&
+      !(std::is_same_v<std::decay_t<Params>, std::decay_t<Args>> && ...)>
+{
+};
+
+// the signatures of Candidates viable for Args, as a tuple of function pointer types
+template <typename Candidates, typename... Args>
+struct viable_signatures;
+
+template <typename... Signatures, typename... Args>
+struct viable_signatures<std::tuple<Signatures...>, Args...>
+{
+  using type = decltype(std::tuple_cat(
+    std::conditional_t<is_viable_signature<Signatures, Args...>::value, std::tuple<Signatures*>, std::tuple<>>()...));
+};
+
+// arg converted to the parameter type Param, or forwarded as is when it already has its type
+template <typename Param, typename Arg>
+decltype(auto) convert_arg(std::remove_reference_t<Arg>& arg)
+{
+  if constexpr(std::is_same_v<std::decay_t<Param>, std::remove_cvref_t<Arg>>)
+  {
+    return static_cast<Arg&&>(arg);
+  }
+  else
+  {
+    return std::decay_t<Param>(static_cast<Arg&&>(arg));
+  }
+}
+
+// signature of the functions of a registry
+template <typename RetType, typename... Args>
+const std::type_info& signature_info()
+{
+  return typeid(RetType(*)(std::decay_t<Args>...));
+}
+
+template <typename RetType, typename... Args>
+std::type_index signature_of()
+{
+  return std::type_index(signature_info<RetType, Args...>());
+}
+
+// a make* or try_make* call, given to the instrumentation policy
+struct make_call
+{
+  size_t hash;                     // hash of the key, 0 for try_make*
+  const std::type_info& signature; // RetType(*)(Args...) of the registry the call looks up
+  bool any_key;                    // try_make*: the registered keys are tried in order
+};
+
+// a registration of a type or a function under a key, given to the instrumentation policy
+struct register_call
+{
+  size_t hash;
+  std::string_view key;            // the key, empty if it is not convertible to a std::string_view
+  const std::type_info& type;      // the registered type, or the return type of the function
+  const std::type_info& signature; // void(*)(Args...), the argument types
+  const std::type_info& registry;  // the static_factory registered in
+  registry_usage (*usage)();       // the size of its registry, to call with the write lock held
+};
+
+// key as a std::string_view, empty if it is not convertible to one
+template <typename Key>
+std::string_view key_view(const Key& key)
+{
+  if constexpr(std::is_convertible_v<const Key&, std::string_view>)
+  {
+    return key;
+  }
+  else
+  {
+    return {};
+  }
+}
+
+// readable name of type, for the reports of the instrumentations
+inline std::string demangle(const std::type_info& type)
+{
+#if defined(__GNUG__)
+  int status = 0;
+  std::unique_ptr<char, void (*)(void*)> name(abi::__cxa_demangle(type.name(), nullptr, nullptr, &status), std::free);
+  if(status == 0 && name)
+  {
+    return name.get();
+  }
+#endif
+  return type.name();
+}
+
+// construct ConcreteType from args declared as Args and return it as RetType:
+// a base_type value, a variant alternative, a raw pointer, a shared pointer or a unique pointer
+template <typename RetType, typename ConcreteType, typename... Args>
+RetType construct(void*, arg_ref<std::decay_t<Args>>... args)
+{
+  if constexpr(std::is_pointer_v<RetType>)
+  {
+    return new ConcreteType(forwarded_arg<Args>(args).get()...);
+  }
+  else if constexpr(is_specialization_of_v<RetType, std::shared_ptr>)
+  {
+    return std::make_shared<ConcreteType>(forwarded_arg<Args>(args).get()...);
+  }
+  else if constexpr(is_specialization_of_v<RetType, std::unique_ptr>)
+  {
+    // not make_unique: a by value parameter is initialized in place, without an intermediate move
+    return RetType(new ConcreteType(forwarded_arg<Args>(args).get()...));
+  }
+  else if constexpr(is_specialization_of_v<RetType, std::variant>)
+  {
+    return RetType(std::in_place_type<ConcreteType>, forwarded_arg<Args>(args).get()...);
+  }
+  else
+  {
+    return ConcreteType(forwarded_arg<Args>(args).get()...);
+  }
+}
+
+// call the callable Func stored in state with args declared as Args and return its result as RetType
+template <typename RetType, typename Func, typename... Args>
+RetType invoke_callable(void* state, arg_ref<std::decay_t<Args>>... args)
+{
+  return RetType((*static_cast<Func*>(state))(forwarded_arg<Args>(args).get()...));
+}
+
+// construct ConcreteType from the value returned by the deserializer Func stored in state for
+// bytes, and return it as RetType. the returned value initializes the object in place
+template <typename RetType, typename ConcreteType, typename Func>
+RetType deserialize(void* state, arg_ref<std::span<const std::byte>> bytes)
+{
+  auto& func = *static_cast<Func*>(state);
+
+  if constexpr(std::is_pointer_v<RetType>)
+  {
+    return new ConcreteType(func(*bytes.value));
+  }
+  else if constexpr(is_specialization_of_v<RetType, std::shared_ptr>)
+  {
+    return std::make_shared<ConcreteType>(func(*bytes.value));
+  }
+  else if constexpr(is_specialization_of_v<RetType, std::unique_ptr>)
+  {
+    return RetType(new ConcreteType(func(*bytes.value)));
+  }
+  else if constexpr(is_specialization_of_v<RetType, std::variant>)
+  {
+    return RetType(std::in_place_type<ConcreteType>, func(*bytes.value));
+  }
+  else
+  {
+    return ConcreteType(func(*bytes.value));
+  }
+}
+
+// the functions registered under one key, one slot per signature, and the candidates chosen by
+// a converting dispatch for the call signatures that have no slot: the plans, cleared when the
+// slots change
+class key_record
+{
+  public:
+  erased_function* find(uint32_t signature)
+  {
+    auto it = std::find_if(m_slots.begin(),
+      m_slots.end(),
+      [signature](const slot& s)
+      {
+        return s.signature == signature;
+      });
+    return it == m_slots.end() ? nullptr : &it->function;
+  }
+
+  erased_function& get(uint32_t signature)
+  {
+    if(auto function = find(signature))
+    {
+      return *function;
+    }
+    m_plans.clear();
+    return m_slots.emplace_back(slot{signature, {}}).function;
+  }
+
+  void erase(uint32_t signature)
+  {
+    std::erase_if(m_slots,
+      [signature](const slot& s)
+      {
+        return s.signature == signature;
+      });
+    m_plans.clear();
+  }
+
+  // index of the candidate signature planned for the call signature, none if not planned yet
+  std::optional<uint32_t> find_plan(uint32_t call) const
+  {
+    for(auto& p : m_plans)
+    {
+      if(p.call == call)
+      {
+        return p.candidate;
+      }
+    }
+    return std::nullopt;
+  }
+
+  void set_plan(uint32_t call, uint32_t candidate)
+  {
+    m_plans.push_back({call, candidate});
+  }
+
+  bool empty() const
+  {
+    return m_slots.empty();
+  }
+
+  size_t size() const
+  {
+    return m_slots.size();
+  }
+
+  // the number of functions with a state
+  size_t states() const
+  {
+    return size_t(std::count_if(m_slots.begin(),
+      m_slots.end(),
+      [](const slot& s)
+      {
+        return s.function.state != nullptr;
+      }));
+  }
+
+  // bytes allocated by the record, not by the states of its functions
+  size_t memory_usage() const
+  {
+    return m_slots.capacity() * sizeof(slot) + m_plans.capacity() * sizeof(plan);
+  }
+
+  void shrink_to_fit()
+  {
+    m_slots.shrink_to_fit();
+    m_plans.shrink_to_fit();
+  }
+
+  template <typename Visitor>
+  void for_each_function(Visitor&& visitor)
+  {
+    for(auto& s : m_slots)
+    {
+      visitor(s.function);
+    }
+  }
+
+  private:
+  struct slot
+  {
+    uint32_t signature;
+    erased_function function;
+  };
+
+  struct plan
+  {
+    uint32_t call;
+    uint32_t candidate;
+  };
+
+  std::vector<slot> m_slots;
+  std::vector<plan> m_plans;
+};
+
+// the registry of a static_factory: an index mapping each key hash once to the record of its
+// signatures, the signatures being numbered in the order they are first registered.
+// the storage only depends on the storage policy, not on the signatures, so its code is shared
+// by all the signatures. a single object per factory so that it can be pinned in one library
+// with STATIC_FACTORY_DEFINE and shared by all the others.
+template <typename Storage>
+class registry_storage
+{
+  public:
+  using index_type = typename Storage::template map<size_t, key_record>;
+
+  // id of signature, assigned if needed. called once per signature and library, by the first
+  // registration or lookup of the signature: the readers sharing the lock of the factory may
+  // assign ids concurrently
+  uint32_t signature_id(std::type_index signature)
+  {
+    std::lock_guard lock(m_signatures_mutex);
+
+    auto it = m_signatures.find(signature);
+    if(it != m_signatures.end())
+    {
+      return it->second;
+    }
+
+    auto id = static_cast<uint32_t>(m_signature_count++);
+    m_signatures.insert(signature, id);
+    return id;
+  }
+
+  // throws std::runtime_error once the registry is sealed
+  void set(size_t hash, uint32_t signature, erased_function function)
+  {
+    check_unsealed();
+
+    auto& record = m_index[hash];
+    auto size    = record.size();
+    auto bytes   = record.memory_usage();
+
+    auto& slot = record.get(signature);
+    m_states += size_t(function.state != nullptr) - size_t(slot.state != nullptr);
+    slot = std::move(function);
+
+    m_functions += record.size() - size;
+    m_record_bytes += record.memory_usage() - bytes;
+  }
+
+  erased_function* find(size_t hash, uint32_t signature)
+  {
+    auto record = find_record(hash);
+    return record ? record->find(signature) : nullptr;
+  }
+
+  key_record* find_record(size_t hash)
+  {
+    auto it = m_index.find(hash);
+    return it == m_index.end() ? nullptr : &it->second;
+  }
+
+  // plan the candidate of a converting dispatch for the call signature in the record of hash.
+  // the write lock must be held, like for a registration, but the plans are kept once sealed
+  void set_plan(size_t hash, uint32_t call, uint32_t candidate)
+  {
+    auto& record = m_index.find(hash)->second;
+    auto bytes   = record.memory_usage();
+
+    record.set_plan(call, candidate);
+    m_record_bytes += record.memory_usage() - bytes;
+  }
+
+  void erase(size_t hash, uint32_t signature)
+  {
+    check_unsealed();
+
+    auto it = m_index.find(hash);
+    if(it == m_index.end())
+    {
+      return;
+    }
+
+    auto& record = it->second;
+    auto size    = record.size();
+    auto states  = record.states();
+
+    record.erase(signature);
+    m_functions -= size - record.size();
+    m_states -= states - record.states();
+    if(record.empty())
+    {
+      m_record_bytes -= record.memory_usage();
+      m_index.erase(hash);
+    }
+  }
+
+  bool contains(size_t hash)
+  {
+    return m_index.find(hash) != m_index.end();
+  }
+
+  // the records in the order the keys were first registered
+  index_type& index()
+  {
+    return m_index;
+  }
+
+  // constant time, the sizes of the records are kept up to date by set and erase
+  registry_usage usage() const
+  {
+    return {m_index.size(),
+      m_functions,
+      m_signatures.size(),
+      m_states,
+      sizeof(*this) + m_index.memory_usage() + m_signatures.memory_usage() + m_record_bytes};
+  }
+
+  // the bytes of the distinct states, without their control blocks
+  size_t state_bytes()
+  {
+    std::vector<std::pair<const void*, size_t>> states;
+    for(auto& [_, record] : m_index)
+    {
+      record.for_each_function(
+        [&states](const erased_function& function)
+        {
+          if(function.state)
+          {
+            states.emplace_back(function.state.get(), function.ops ? function.ops->size : 0);
+          }
+        });
+    }
+
+    std::sort(states.begin(), states.end());
+    states.erase(std::unique(states.begin(), states.end()), states.end());
+
+    size_t bytes = 0;
+    for(auto& [_, size] : states)
+    {
+      bytes += size;
+    }
+    return bytes;
+  }
+
+  //
+  // shrink the tables to fit and move the states only referenced by the registry into one
+  // allocation, in registration order
+  //
+  void compact()
+  {
+    m_signatures.shrink_to_fit();
+    m_index.shrink_to_fit();
+
+    m_record_bytes = 0;
+    for(auto& [_, record] : m_index)
+    {
+      record.shrink_to_fit();
+      m_record_bytes += record.memory_usage();
+    }
+
+    pack_states();
+  }
+
+  // compact and reject the registrations and the unregistrations from now on
+  void seal()
+  {
+    compact();
+    m_sealed = true;
+  }
+
+  bool sealed() const
+  {
+    return m_sealed;
+  }
+
+  private:
+  // the states packed by compact(), destroyed with the last function referencing one of them
+  class state_arena
+  {
+    public:
+    state_arena(size_t size, size_t align, size_t count)
+      : m_buffer{static_cast<std::byte*>(::operator new(size, std::align_val_t(align)))},
+        m_align{align}
+    {
+      m_states.reserve(count);
+    }
+
+    state_arena(const state_arena&)            = delete;
+    state_arena& operator=(const state_arena&) = delete;
+
+    ~state_arena()
+    {
+      for(auto it = m_states.rbegin(); it != m_states.rend(); ++it)
+      {
+        it->second->destroy(it->first);
+      }
+      ::operator delete(m_buffer, std::align_val_t(m_align));
+    }
+
+    std::byte* data()
+    {
+      return m_buffer;
+    }
+
+    // move the state at from to offset
+    void emplace(void* from, const state_ops* ops, size_t offset)
+    {
+      ops->move(from, m_buffer + offset);
+      m_states.emplace_back(m_buffer + offset, ops);
+    }
+
+    private:
+    std::byte* m_buffer;
+    size_t m_align;
+    std::vector<std::pair<void*, const state_ops*>> m_states;
+  };
+
+  //
+  // the states are grouped by owner: the allocation of a state, or the arena of a previous
+  // compact(). a group is moved if all its states are movable and nothing but the registry
+  // references it, e.g. not a lazy_ptr made before
+  //
+  void pack_states()
+  {
+    // the functions with a state, in registration order
+    std::vector<erased_function*> functions;
+    for(auto& [_, record] : m_index)
+    {
+      record.for_each_function(
+        [&functions](erased_function& function)
+        {
+          if(function.state)
+          {
+            functions.push_back(&function);
+          }
+        });
+    }
+
+    auto groups = functions;
+    std::stable_sort(groups.begin(),
+      groups.end(),
+      [](const erased_function* a, const erased_function* b)
+      {
+        return a->state.owner_before(b->state);
+      });
+
+    // the states to move and their offset in the arena, npos until placed
+    constexpr size_t npos_offset = SIZE_MAX;
+    std::unordered_map<const void*, size_t> offsets;
+
+    for(auto first = groups.begin(); first != groups.end();)
+    {
+      auto last = std::find_if(first,
+        groups.end(),
+        [first](const erased_function* function)
+        {
+          return (*first)->state.owner_before(function->state);
+        });
+
+      bool movable = (*first)->state.use_count() == last - first &&
+                     std::all_of(first,
+                       last,
+                       [](const erased_function* function)
+                       {
+                         return function->ops && function->ops->move;
+                       });
+      for(auto it = first; movable && it != last; ++it)
+      {
+        offsets.emplace((*it)->state.get(), npos_offset);
+      }
+      first = last;
+    }
+
+    if(offsets.empty())
+    {
+      return;
+    }
+
+    std::vector<erased_function*> placed;
+    size_t size  = 0;
+    size_t align = alignof(std::max_align_t);
+    for(auto function : functions)
+    {
+      auto it = offsets.find(function->state.get());
+      if(it != offsets.end() && it->second == npos_offset)
+      {
+        auto ops   = function->ops;
+        size       = (size + ops->align - 1) / ops->align * ops->align;
+        it->second = size;
+        size += ops->size;
+        align = std::max(align, ops->align);
+        placed.push_back(function);
+      }
+    }
+
+    // the moves cannot throw: the functions are updated once all the states are moved
+    auto arena = std::make_shared<state_arena>(size, align, placed.size());
+    for(auto function : placed)
+    {
+      arena->emplace(function->state.get(), function->ops, offsets[function->state.get()]);
+    }
+
+    for(auto function : functions)
+    {
+      auto it = offsets.find(function->state.get());
+      if(it != offsets.end())
+      {
+        function->state = std::shared_ptr<void>(arena, arena->data() + it->second);
+      }
+    }
+  }
+
+  void check_unsealed() const
+  {
+    if(m_sealed)
+    {
+      throw std::runtime_error("Registry is sealed");
+    }
+  }
+
+  std::mutex m_signatures_mutex;
+  unordered_flat_map<std::type_index, uint32_t> m_signatures;
+  size_t m_signature_count = 0;
+  index_type m_index;
+  size_t m_functions    = 0;
+  size_t m_states       = 0;
+  size_t m_record_bytes = 0; // allocated by the records
+  bool m_sealed         = false;
+};
+
+// the object of a lazy_ptr, made by create on the first call to get.
+// the error thrown by create is kept and rethrown by every call to get
+template <typename T>
+class lazy_state
+{
+  public:
+  virtual ~lazy_state() = default;
+
+  T* get()
+  {
+    auto object = m_object.load(std::memory_order_acquire);
+    if(!object)
+    {
+      std::call_once(m_once,
+        [this]
+        {
+          try
+          {
+            m_owner = create();
+          }
+          catch(...)
+          {
+            m_error = std::current_exception();
+          }
+          m_object.store(m_owner.get(), std::memory_order_release);
+        });
+
+      if(m_error)
+      {
+        std::rethrow_exception(m_error);
+      }
+      object = m_owner.get();
+    }
+    return object;
+  }
+
+  bool constructed() const
+  {
+    return m_object.load(std::memory_order_acquire) != nullptr;
+  }
+
+  protected:
+  virtual std::unique_ptr<T> create() = 0;
+
+  private:
+  std::once_flag m_once;
+  std::atomic<T*> m_object = nullptr;
+  std::unique_ptr<T> m_owner;
+  std::exception_ptr m_error;
+};
+
+// a lazy_state making its object with Create from the captured Args, released once used
+template <typename T, typename Create, typename... Args>
+class lazy_capture final : public lazy_state<T>
+{
+  public:
+  template <typename... CapturedArgs>
+  lazy_capture(Create create, CapturedArgs&&... args)
+    : m_create{std::move(create)},
+      m_args{std::in_place, std::forward<CapturedArgs>(args)...}
+  {
+  }
+
+  private:
+  std::unique_ptr<T> create() override
+  {
+    auto object = std::apply(m_create, *m_args);
+    m_args.reset();
+    return object;
+  }
+
+  Create m_create;
+  std::optional<std::tuple<Args...>> m_args;
+};
+
+} // namespace detail
+
+/**
+ * \brief The lazy_ptr class holds an object made on its first dereference.
+ *
+ * A lazy_ptr is returned by static_factory::make_lazy with the function registered under the key
+ * and a copy of the arguments. The object is made once, thread safely, by the first call to get(),
+ * operator* or operator->; an unused lazy_ptr never constructs it. The copies of a lazy_ptr share
+ * the same object, which is destroyed with the last copy.
+ *
+ * \tparam T The type of the object, the base type of the factory.
+ */
+template <typename T>
+class lazy_ptr
+{
+  public:
+  using element_type = T;
+
+  lazy_ptr() = default;
+
+  explicit lazy_ptr(std::shared_ptr<detail::lazy_state<T>> state) : m_state{std::move(state)}
+  {
+  }
+
+  //
+  // the object, made on the first call. rethrows the error of its construction
+  // nullptr for an empty lazy_ptr, or if the error policy returned nullptr
+  //
+  T* get() const
+  {
+    return m_state ? m_state->get() : nullptr;
+  }
+
+  T& operator*() const
+  {
+    return *get();
+  }
+
+  T* operator->() const
+  {
+    return get();
+  }
+
+  // true if the object can be made, even if it was not made yet
+  explicit operator bool() const
+  {
+    return m_state != nullptr;
+  }
+
+  // true once the object was made
+  bool constructed() const
+  {
+    return m_state && m_state->constructed();
+  }
+
+  private:
+  std::shared_ptr<detail::lazy_state<T>> m_state;
+};
+
+/**
+ * \brief The policies a static_factory is compiled with.
+ *
+ * A policy set provides a locking, a storage, a hash, an error, a dispatch and an instrumentation
+ * policy.
+ * Derive from defaults and override the ones to change, e.g:
+ *
+ *  struct single_threaded : factory_policies::defaults
+ *  {
+ *    using locking = factory_policies::no_locking;
+ *  };
+ *
+ *  using pet_factory = static_factory<Pet, std::string, single_threaded>;
+ */
+namespace factory_policies
+{
+
+//
+// locking policies: the mutex type and the guards taken to read (make*) and to write (register*)
+//
+
+// a single mutex, readers are serialized
+struct mutex_locking
+{
+  using mutex_type = std::mutex;
+  using read_lock  = std::lock_guard<mutex_type>;
+  using write_lock = std::lock_guard<mutex_type>;
+};
+
+// read-mostly factories: readers share the lock, registrations are exclusive
+struct shared_mutex_locking
+{
+  using mutex_type = std::shared_mutex;
+  using read_lock  = std::shared_lock<mutex_type>;
+  using write_lock = std::unique_lock<mutex_type>;
+};
+
+// single threaded factories: no locking at all
+struct no_locking
+{
+  struct mutex_type
+  {
+  };
+
+  struct guard
+  {
+    constexpr explicit guard(mutex_type&) noexcept
+    {
+    }
+  };
+
+  using read_lock  = guard;
+  using write_lock = guard;
+};
+
+//
+// storage policies: the map type of a registry, keyed by the key hash, in registration order
+//
+
+// linear scan, the cheapest for small registries
+struct linear_storage
+{
+  template <typename Key, typename Value>
+  using map = detail::unordered_flat_map<Key, Value>;
+};
+
+// hashed index over the linear storage, for large registries
+struct hashed_storage
+{
+  template <typename Key, typename Value>
+  using map = detail::hashed_flat_map<Key, Value>;
+};
+
+//
+// hash policy: any default constructible callable returning a size_t for a key.
+// the registries keep the hash of a key, not the key: keys of equal hashes are the same key for
+// the factory and share their registrations, so the hash must not collide on the keys in use
+//
+
+struct std_hash
+{
+  template <typename Key>
+  size_t operator()(const Key& key) const
+  {
+    return std::hash<Key>()(key);
+  }
+};
+
+//
+// error policies: what make* and try_make* do when no valid registry is found and when the
+// registered function throws
+//
+
+// throws std::runtime_error when no valid registry is found, propagates the exceptions
+struct throw_on_error
+{
+  template <typename RetType>
+  [[noreturn]] static RetType not_found(const char* message)
+  {
+    throw std::runtime_error(message);
+  }
+
+  template <typename RetType>
+  [[noreturn]] static RetType failed(std::exception_ptr eptr)
+  {
+    std::rethrow_exception(eptr);
+  }
+
+  template <typename RetType, typename Func, typename... Args>
+  static RetType invoke(Func& func, Args&&... args)
+  {
+    return func(std::forward<Args>(args)...);
+  }
+};
+
+// never throws: returns a default constructed value (nullptr for the pointers) instead
+struct nothrow_on_error
+{
+  template <typename RetType>
+  static RetType not_found(const char*) noexcept
+  {
+    static_assert(std::is_default_constructible_v<RetType>,
+      "nothrow_on_error requires a default constructible base_type");
+
+    return RetType();
+  }
+
+  template <typename RetType>
+  static RetType failed(std::exception_ptr) noexcept
+  {
+    return not_found<RetType>(nullptr);
+  }
+
+  template <typename RetType, typename Func, typename... Args>
+  static RetType invoke(Func& func, Args&&... args) noexcept
+  {
+    try
+    {
+      return func(std::forward<Args>(args)...);
+    }
+    catch(...)
+    {
+      return not_found<RetType>(nullptr);
+    }
+  }
+};
+
+//
+// dispatch policies: the argument lists make falls back to when nothing is registered under the
+// key for the exact argument types
+//
+
+// exact argument types only
+struct exact_dispatch
+{
+  using candidates = std::tuple<>;
+};
+
+// the first candidate signature, in order, convertible from the arguments and registered under
+// the key. e.g: converting_dispatch<void(std::string)> lets make("Dog", "Rex") call the function
+// registered for std::string. the viable candidates are selected at compile time, the one
+// registered under a key is looked up once per argument types and kept in the record of the key
+// until its functions change
+template <typename... Signatures>
+struct converting_dispatch
+{
+  using candidates = std::tuple<Signatures...>;
+};
+
+//
+// instrumentation policies: a scope constructed with the detail::make_call at the beginning of
+// every make* and try_make* call, notified with locked() once the read lock is acquired, and
+// destroyed when the call returns or throws. a register_scope spans each registration of a key,
+// with the write lock held
+//
+
+// no instrumentation, the scopes compile away. derive from it to override one of them
+struct no_instrumentation
+{
+  struct scope
+  {
+    constexpr explicit scope(const detail::make_call&) noexcept
+    {
+    }
+
+    constexpr void locked() noexcept
+    {
+    }
+  };
+
+  struct register_scope
+  {
+    constexpr explicit register_scope(const detail::register_call&) noexcept
+    {
+    }
+  };
+};
+
+struct defaults
+{
+  using locking         = mutex_locking;
+  using storage         = linear_storage;
+  using hash            = std_hash;
+  using error           = throw_on_error;
+  using dispatch        = exact_dispatch;
+  using instrumentation = no_instrumentation;
+};
+
+} // namespace factory_policies
+
+/**
+ * \brief The static_factory class provides a static factory pattern implementation.
+ *
+ * The static_factory class allows registration of types and functions, and provides
+ * methods to create instances of registered types. It supports creating instances
+ * as BaseType, raw pointers, shared pointers, and unique pointers.
+ *
+ * \tparam BaseType The base type of the registered types.
+ * \tparam KeyType The type of the key used for registration. (default is std::string)
+ * \tparam Policies The locking, storage, hash, error, dispatch and instrumentation policies. (default is factory_policies::defaults)
+ */
+template <typename BaseType, typename KeyType = std::string, typename Policies = factory_policies::defaults>
+class static_factory
+{
+  public:
+  using base_type     = BaseType;
+  using key_type      = KeyType;
+  using policies_type = Policies;
+
+  // what make_from_bytes returns: base_type itself for the variant and copyable base types, whose
+  // deserializers return values, else a unique pointer of base_type
+  using decoded_type =
+    std::conditional_t<std::is_move_constructible_v<base_type>, base_type, std::unique_ptr<base_type>>;
+
+  //
+  // a key hashed once, for the callers making many objects of the same keys:
+  // the make* overloads taking a prepared_key skip the hashing
+  //
+  struct prepared_key
+  {
+    size_t hash;
+  };
+
+  static prepared_key prepare(const key_type& key)
+  {
+    return {g_hash_function(key)};
+  }
+
+  template <typename Func>
+  static void register_function(const key_type& key, Func&& func)
+  {
+    load_section_entries();
+    write_lock lock(g_mutex);
+
+    register_function_impl(key, std::forward<Func>(func));
+  }
+
+  //
+  // register the (key, function) pairs of one or more ranges in one batch, under a single lock
+  //
+  template <typename... Ranges>
+  static void register_functions(const Ranges&... functions)
+  {
+    load_section_entries();
+    write_lock lock(g_mutex);
+
+    (register_functions_impl(functions), ...);
+  }
+
+  //
+  // register the (key, function) pairs of the ranges in one batch like register_functions, unless
+  // one of the keys is already registered, for any argument types: nothing is registered then.
+  // returns the keys found registered, empty if the functions were registered
+  //
+  template <typename... Ranges>
+  static std::vector<key_type> try_register_functions(const Ranges&... functions)
+  {
+    load_section_entries();
+    write_lock lock(g_mutex);
+
+    std::vector<key_type> registered;
+    std::vector<size_t> hashes;
+
+    auto find_registered = [&](const auto& range)
+    {
+      for(auto&& [key, _] : range)
+      {
+        auto hash = g_hash_function(key);
+        if(g_storage.contains(hash) && std::find(hashes.begin(), hashes.end(), hash) == hashes.end())
+        {
+          registered.push_back(key);
+          hashes.push_back(hash);
+        }
+      }
+    };
+    (find_registered(functions), ...);
+
+    if(registered.empty())
+    {
+      (register_functions_impl(functions), ...);
+    }
+
+    return registered;
+  }
+
+  //
+  // remove the (key, function) pairs of one or more ranges registered with register_functions,
+  // in one batch under a single lock. a function is removed only while it is the one registered
+  // under its key, compared with ==, not once another function replaced it.
+  // returns the number of functions removed
+  //
+  template <typename... Ranges>
+  static size_t unregister_functions(const Ranges&... functions)
+  {
+    load_section_entries();
+    write_lock lock(g_mutex);
+
+    size_t count = 0;
+
+    auto erase = [&count](const auto& range)
+    {
+      for(auto&& [key, func] : range)
+      {
+        count += unregister_function_impl(key, func);
+      }
+    };
+    (erase(functions), ...);
+
+    return count;
+  }
+
+  //
+  // remove the types and functions registered under key for the argument types Args
+  //
+  template <typename... Args>
+  static void unregister(const key_type& key)
+  {
+    load_section_entries();
+    write_lock lock(g_mutex);
+
+    auto hash = g_hash_function(key);
+
+    if constexpr(!std::is_abstract_v<base_type>)
+    {
+      g_storage.erase(hash, get_signature<base_type, Args...>());
+    }
+    g_storage.erase(hash, get_signature<base_type*, Args...>());
+    g_storage.erase(hash, get_signature<std::shared_ptr<base_type>, Args...>());
+    g_storage.erase(hash, get_signature<std::unique_ptr<base_type>, Args...>());
+  }
+
+  //
+  // register ConcreteType, constructible from a std::span<const std::byte>, to be made from bytes
+  // with make_from_bytes. the type may keep views into the bytes instead of copies, the bytes
+  // must then outlive the object
+  //
+  template <typename ConcreteType>
+  static void register_deserializer(const key_type& key)
+  {
+    register_type<ConcreteType, std::span<const std::byte>>(key);
+  }
+
+  //
+  // register the deserializer func, returning a ConcreteType for a std::span<const std::byte>,
+  // to make ConcreteType from bytes with make_from_bytes. the value returned by func initializes
+  // the object in place
+  // e.g: register_deserializer<Ping>("Ping", [](std::span<const std::byte> bytes) { return Ping(parse(bytes)); });
+  //
+  template <typename ConcreteType, typename Func>
+  static void register_deserializer(const key_type& key, Func&& func)
+  {
+    static_assert(detail::is_related_v<base_type, ConcreteType>, "Invalid type");
+    static_assert(std::is_invocable_r_v<ConcreteType, Func&, std::span<const std::byte>>,
+      "The deserializer must return a ConcreteType for a std::span<const std::byte>");
+
+    using func_type = std::decay_t<Func>;
+    using bytes     = std::span<const std::byte>;
+
+    load_section_entries();
+    write_lock lock(g_mutex);
+
+    auto hash = g_hash_function(key);
+
+    registration_scope scope(registration_of<ConcreteType, bytes>(hash, key));
+
+    auto state = detail::make_state<func_type>(std::forward<Func>(func));
+
+    if constexpr(std::is_convertible_v<ConcreteType, base_type>)
+    {
+      set_function<base_type, bytes>(hash, &detail::deserialize<base_type, ConcreteType, func_type>, state);
+    }
+    else
+    {
+      set_function<base_type*, bytes>(hash, &detail::deserialize<base_type*, ConcreteType, func_type>, state);
+      set_function<std::shared_ptr<base_type>, bytes>(hash,
+        &detail::deserialize<std::shared_ptr<base_type>, ConcreteType, func_type>,
+        state);
+      set_function<std::unique_ptr<base_type>, bytes>(hash,
+        &detail::deserialize<std::unique_ptr<base_type>, ConcreteType, func_type>,
+        state);
+    }
+  }
+
+  //
+  // true if a type or a function is registered under key, for any argument types
+  //
+  static bool contains(const key_type& key)
+  {
+    load_section_entries();
+    read_lock lock(g_mutex);
+
+    return g_storage.contains(g_hash_function(key));
+  }
+
+  //
+  // the size of the registry and the bytes it allocates, including the states of the functions
+  //
+  static registry_usage memory_usage()
+  {
+    load_section_entries();
+    write_lock lock(g_mutex);
+
+    auto result        = g_storage.usage();
+    result.state_bytes = g_storage.state_bytes();
+    return result;
+  }
+
+  //
+  // shrink the tables of the registry to fit and move the states of the registered functions,
+  // the callables and the deserializers, into one allocation. the states referenced outside the
+  // registry, e.g. by a lazy_ptr, and the pinned ones, e.g. the creators of a plugin_loader,
+  // are left in place
+  //
+  static void compact()
+  {
+    load_section_entries();
+    write_lock lock(g_mutex);
+
+    g_storage.compact();
+  }
+
+  //
+  // compact the registry at the end of the registrations: the registrations and unregistrations
+  // that follow throw std::runtime_error
+  //
+  static void seal()
+  {
+    load_section_entries();
+    write_lock lock(g_mutex);
+
+    g_storage.seal();
+  }
+
+  static bool sealed()
+  {
+    read_lock lock(g_mutex);
+
+    return g_storage.sealed();
+  }
+
+  template <typename ConcreteType, typename... Args>
+  static void register_type(const key_type& key)
+  {
+    static_assert(detail::is_related_v<base_type, ConcreteType>, "Invalid type");
+
+    load_section_entries();
+    write_lock lock(g_mutex);
+
+    register_type_impl<ConcreteType, Args...>(key);
+  }
+
+  template <typename ConcreteType, typename... Args>
+  static void register_type()
+  {
+    register_type<ConcreteType, Args...>(typeid(ConcreteType).hash_code());
+  }
+
+  //
+  // register every alternative of a std::variant base_type constructible from Args in one batch.
+  // keys are given in the order of the alternatives, one key per alternative.
+  // e.g: static_factory<std::variant<Dog, Cat>>::register_variant_alternatives<std::string>("Dog", "Cat");
+  //
+  template <typename... Args, typename... Keys>
+    requires(detail::is_specialization_of_v<base_type, std::variant>)
+  static void register_variant_alternatives(const Keys&... keys)
+  {
+    static_assert(sizeof...(Keys) == std::variant_size_v<base_type>,
+      "One key per variant alternative is required");
+
+    const std::array<key_type, sizeof...(Keys)> alternative_keys = {key_type(keys)...};
+
+    load_section_entries();
+    write_lock lock(g_mutex);
+
+    [&]<size_t... Index>(std::index_sequence<Index...>)
+    {
+      (register_alternative_impl<std::variant_alternative_t<Index, base_type>, Args...>(alternative_keys[Index]),
+        ...);
+    }(std::make_index_sequence<sizeof...(Keys)>());
+  }
+
+  //
+  // try to make instance of base_type using the key and args
+  // throws std::runtime_error if no valid registry is found
+  //
+  template <typename... Args>
+  static base_type make(const key_type& key, Args&&... args)
+  {
+    return make_impl<base_type, Args...>(g_hash_function(key), std::forward<Args>(args)...);
+  };
+
+  template <typename... Args>
+  static base_type make(prepared_key key, Args&&... args)
+  {
+    return make_impl<base_type, Args...>(key.hash, std::forward<Args>(args)...);
+  }
+
+  //
+  // try to make instance of base_type using the resgistered ConcreteType
+  // throws std::runtime_error if no valid registry is found
+  //
+  template <typename ConcreteType, typename... Args>
+    requires(std::is_convertible_v<ConcreteType, base_type>)
+  static base_type make(Args&&... args)
+  {
+    if constexpr(detail::is_specialization_of_v<base_type, std::variant>)
+    {
+      // alternatives of a variant base_type are resolved at compile time, no registration needed
+      if constexpr(detail::variant_index_v<ConcreteType, base_type> != std::variant_npos &&
+        std::is_constructible_v<ConcreteType, Args&&...>)
+      {
+        return base_type(std::in_place_type<ConcreteType>, std::forward<Args>(args)...);
+      }
+    }
+
+    return make_impl<base_type, Args...>(typeid(ConcreteType).hash_code(), std::forward<Args>(args)...);
+  }
+
+  //
+  // make the alternative at index of a std::variant base_type using the provided args
+  // the constructors are looked up in a compile time table, no registration is needed
+  // throws std::runtime_error if the alternative is not constructible from args
+  //
+  template <typename... Args>
+    requires(detail::is_specialization_of_v<base_type, std::variant>)
+  static base_type make_alternative(size_t index, Args&&... args)
+  {
+    constexpr auto& constructors = detail::variant_constructor_table<base_type, Args...>::value;
+
+    if(index >= constructors.size() || constructors[index] == nullptr)
+    {
+      return error_policy::template not_found<base_type>("Registry not found");
+    }
+
+    return error_policy::template invoke<base_type>(constructors[index], std::forward<Args>(args)...);
+  }
+
+  //
+  // index of ConcreteType among the alternatives of a std::variant base_type
+  //
+  template <typename ConcreteType>
+    requires(detail::is_specialization_of_v<base_type, std::variant>)
+  static constexpr size_t alternative_index()
+  {
+    static_assert(detail::variant_index_v<ConcreteType, base_type> != std::variant_npos,
+      "ConcreteType is not a unique alternative of base_type");
+
+    return detail::variant_index_v<ConcreteType, base_type>;
+  }
+
+  //
+  // loop through all the registered keys and try to make instance of base_type using the provided args
+  // throws std::runtime_error if no valid registry is found
+  //
+  template <typename... Args>
+  static base_type try_make(Args&&... args)
+  {
+    return try_make_impl<base_type, Args...>(std::forward<Args>(args)...);
+  }
+
+  //
+  // make raw ptr
+  //
+
+  //
+  // try to make a raw pointer of base_type using the key and args
+  // returns nullptr if no valid registry is found
+  //
+  template <typename... Args>
+  static base_type* make_ptr(const key_type& key, Args&&... args)
+  {
+    return make_impl<base_type*, Args...>(g_hash_function(key), std::forward<Args>(args)...);
+  }
+
+  template <typename... Args>
+  static base_type* make_ptr(prepared_key key, Args&&... args)
+  {
+    return make_impl<base_type*, Args...>(key.hash, std::forward<Args>(args)...);
+  }
+
+  //
+  // try to make a raw pointer using ConcreteType and cast it to ConcreteType*
+  // returns nullptr if no valid registry is found
+  //
+  template <typename ConcreteType, typename... Args>
+  static ConcreteType* make_ptr(Args&&... args)
+  {
+    return static_cast<ConcreteType*>(
+      make_impl<base_type*, Args...>(typeid(ConcreteType).hash_code(), std::forward<Args>(args)...));
+  }
+
+  //
+  // loop through all the registered keys and try to make a raw pointer of base_type using the provided args
+  // returns nullptr if no valid registry is found
+  //
+  template <typename... Args>
+  static base_type* try_make_ptr(Args&&... args)
+  {
+    return try_make_impl<base_type*, Args...>(std::forward<Args>(args)...);
+  }
+
+  //
+  // make shared_ptr
+  //
+
+  //
+  // try to make a shared pointer of base_type using the key and args
+  // returns nullptr if no valid registry is found
+  //
+  template <typename... Args>
+  static std::shared_ptr<base_type> make_shared(const key_type& key, Args&&... args)
+  {
+    return make_impl<std::shared_ptr<base_type>, Args...>(g_hash_function(key), std::forward<Args>(args)...);
+  }
+
+  template <typename... Args>
+  static std::shared_ptr<base_type> make_shared(prepared_key key, Args&&... args)
+  {
+    return make_impl<std::shared_ptr<base_type>, Args...>(key.hash, std::forward<Args>(args)...);
+  }
+
+  //
+  // try to make a shared pointer using ConcreteType and cast it to
+  // std::shared_ptr<ConcreteType> returns nullptr if no valid registry is found
+  //
+  template <typename ConcreteType, typename... Args>
+  static std::shared_ptr<ConcreteType> make_shared(Args&&... args)
+  {
+    return std::static_pointer_cast<ConcreteType>(make_impl<std::shared_ptr<base_type>, Args...>(
+      typeid(ConcreteType).hash_code(), std::forward<Args>(args)...));
+  }
+
+  //
+  // loop through all the registered keys and try to make a shared pointer of base_type using the provided args
+  // returns nullptr if no valid registry is found
+  //
+  template <typename... Args>
+  static std::shared_ptr<base_type> try_make_shared(Args&&... args)
+  {
+    return try_make_impl<std::shared_ptr<base_type>, Args...>(std::forward<Args>(args)...);
+  }
+
+  //
+  // make unique_ptr
+  //
+
+  //
+  // try to make a unique pointer of base_type using the key and args
+  // returns nullptr if no valid registry is found
+  //
+  template <typename... Args>
+  static std::unique_ptr<base_type> make_unique(const key_type& key, Args&&... args)
+  {
+    return make_impl<std::unique_ptr<base_type>, Args...>(g_hash_function(key), std::forward<Args>(args)...);
+  }
+
+  template <typename... Args>
+  static std::unique_ptr<base_type> make_unique(prepared_key key, Args&&... args)
+  {
+    return make_impl<std::unique_ptr<base_type>, Args...>(key.hash, std::forward<Args>(args)...);
+  }
+
+  //
+  // make lazy_ptr
+  //
+
+  //
+  // a lazy_ptr making a unique pointer of base_type with the function registered under the key
+  // for args on its first dereference. the function is looked up now and the args are copied,
+  // or moved for rvalues, until then
+  // throws std::runtime_error if no valid registry is found
+  //
+  template <typename... Args>
+  static lazy_ptr<base_type> make_lazy(const key_type& key, Args&&... args)
+  {
+    return make_lazy_impl<Args...>(g_hash_function(key), std::forward<Args>(args)...);
+  }
+
+  template <typename... Args>
+  static lazy_ptr<base_type> make_lazy(prepared_key key, Args&&... args)
+  {
+    return make_lazy_impl<Args...>(key.hash, std::forward<Args>(args)...);
+  }
+
+  //
+  // make from bytes
+  //
+
+  //
+  // make a decoded_type from bytes with the deserializer registered under key: a value of the
+  // variant and copyable base types, a unique pointer of base_type otherwise
+  // throws std::runtime_error if no deserializer is found
+  //
+  static decoded_type make_from_bytes(const key_type& key, std::span<const std::byte> bytes)
+  {
+    return make_impl<decoded_type, std::span<const std::byte>>(g_hash_function(key), std::move(bytes));
+  }
+
+  static decoded_type make_from_bytes(prepared_key key, std::span<const std::byte> bytes)
+  {
+    return make_impl<decoded_type, std::span<const std::byte>>(key.hash, std::move(bytes));
+  }
+
+  //
+  // try to make a unique pointer using ConcreteType and cast it to
+  // std::unique_ptr<ConcreteType> returns nullptr if no valid registry is found
+  //
+  template <typename ConcreteType, typename... Args>
+  static std::unique_ptr<ConcreteType> make_unique(Args&&... args)
+  {
+    auto obj = make_impl<std::unique_ptr<base_type>, Args...>(typeid(ConcreteType).hash_code(),
+      std::forward<Args>(args)...);
+
+    return std::unique_ptr<ConcreteType>(static_cast<ConcreteType*>(obj.release()));
+  }
+
+  //
+  // loop through all the registered keys and try to make a unique pointer of base_type using the provided args
+  // returns nullptr if no valid registry is found
+  //
+  template <typename... Args>
+  static std::unique_ptr<base_type> try_make_unique(Args&&... args)
+  {
+    return try_make_impl<std::unique_ptr<base_type>, Args...>(std::forward<Args>(args)...);
+  }
+
+  private:
+  static_factory() = delete;
+
+  template <typename, typename, typename...>
+  friend struct detail::section_registrar;
+
+  using mutex_type            = typename Policies::locking::mutex_type;
+  using read_lock             = typename Policies::locking::read_lock;
+  using write_lock            = typename Policies::locking::write_lock;
+  using error_policy          = typename Policies::error;
+  using instrumentation_scope = typename Policies::instrumentation::scope;
+  using registration_scope    = typename Policies::instrumentation::register_scope;
+
+  using storage_type = detail::registry_storage<typename Policies::storage>;
+
+  template <typename RetType, typename... Args>
+  using thunk_type = detail::thunk_type<RetType, std::decay_t<Args>...>;
+
+  //
+  // call the function registered under hash for RetType(Args...), or for the candidate signature
+  // the dispatch policy converts the arguments to. the function is copied under the read lock and
+  // called once it is released, so that the constructors run concurrently and may use the
+  // factory: the copy keeps its state alive if it is unregistered meanwhile
+  //
+  template <typename RetType, typename... Args>
+  static RetType make_impl(size_t hash, Args&&... args)
+  {
+    instrumentation_scope scope(detail::make_call{hash, detail::signature_info<RetType, Args...>(), false});
+
+    using candidates = typename detail::viable_signatures<typename Policies::dispatch::candidates, Args...>::type;
+
+    load_section_entries();
+
+    detail::erased_function function;
+    std::optional<uint32_t> candidate; // set for a converting dispatch, the number of candidates if none
+    bool unplanned = false;
+    {
+      read_lock lock(g_mutex);
+      scope.locked();
+
+      if(auto record = g_storage.find_record(hash))
+      {
+        if(auto found = record->find(get_signature<RetType, Args...>()))
+        {
+          function = *found;
+        }
+        else if constexpr(std::tuple_size_v<candidates> != 0)
+        {
+          candidate = record->find_plan(get_signature<RetType, Args...>());
+          if(candidate)
+          {
+            function = copy_candidate_function<RetType, 0, candidates>(*candidate, *record);
+          }
+          unplanned = !candidate;
+        }
+      }
+    }
+
+    if constexpr(std::tuple_size_v<candidates> != 0)
+    {
+      if(unplanned)
+      {
+        candidate = plan_conversion<RetType, Args...>(hash, function);
+      }
+      if(candidate)
+      {
+        return make_candidate<RetType, 0, candidates>(*candidate, function, std::forward<Args>(args)...);
+      }
+    }
+
+    if(!function.thunk)
+    {
+      return error_policy::template not_found<RetType>("Registry not found");
+    }
+
+    auto thunk = reinterpret_cast<thunk_type<RetType, Args...>>(function.thunk);
+
+    return error_policy::template invoke<RetType>(thunk,
+      function.state.get(),
+      detail::make_arg_ref(detail::decay_arg<Args>(args))...);
+  }
+
+  //
+  // capture the function registered under hash for std::unique_ptr<base_type>(Args...), or the
+  // hash when the dispatch policy may convert the arguments, with a copy of args
+  //
+  template <typename... Args>
+  static lazy_ptr<base_type> make_lazy_impl(size_t hash, Args&&... args)
+  {
+    using RetType    = std::unique_ptr<base_type>;
+    using candidates = typename detail::viable_signatures<typename Policies::dispatch::candidates, Args...>::type;
+
+    load_section_entries();
+
+    detail::erased_function function;
+    {
+      read_lock lock(g_mutex);
+      if(auto found = find_function<RetType, Args...>(hash))
+      {
+        function = *found;
+      }
+    }
+
+    if(function.thunk)
+    {
+      auto create = [thunk = reinterpret_cast<thunk_type<RetType, Args...>>(function.thunk),
+                      state = std::move(function.state)](std::decay_t<Args>&... captured)
+      {
+        return error_policy::template invoke<RetType>(thunk,
+          state.get(),
+          detail::make_arg_ref(std::move(captured))...);
+      };
+      return make_lazy_ptr<Args...>(std::move(create), std::forward<Args>(args)...);
+    }
+    else if constexpr(std::tuple_size_v<candidates> != 0)
+    {
+      auto create = [hash](std::decay_t<Args>&... captured)
+      {
+        return make_impl<RetType, std::decay_t<Args>...>(hash, std::move(captured)...);
+      };
+      return make_lazy_ptr<Args...>(std::move(create), std::forward<Args>(args)...);
+    }
+    else
+    {
+      return error_policy::template not_found<lazy_ptr<base_type>>("Registry not found");
+    }
+  }
+
+  template <typename... Args, typename Create>
+  static lazy_ptr<base_type> make_lazy_ptr(Create create, Args&&... args)
+  {
+    using state_type = detail::lazy_capture<base_type, Create, std::decay_t<Args>...>;
+
+    return lazy_ptr<base_type>(std::make_shared<state_type>(std::move(create), std::forward<Args>(args)...));
+  }
+
+  //
+  // the first viable candidate signature of the dispatch policy registered under hash for a call
+  // of RetType(Args...), kept in the record of the key until its functions change, and a copy of
+  // its function. takes the write lock: called once per key and call signature
+  //
+  template <typename RetType, typename... Args>
+  static uint32_t plan_conversion(size_t hash, detail::erased_function& function)
+  {
+    using candidates = typename detail::viable_signatures<typename Policies::dispatch::candidates, Args...>::type;
+
+    write_lock lock(g_mutex);
+
+    auto record = g_storage.find_record(hash);
+    if(!record)
+    {
+      return std::tuple_size_v<candidates>;
+    }
+
+    // planned by another call since the read lock was released, or planned now
+    auto call      = get_signature<RetType, Args...>();
+    auto candidate = record->find_plan(call);
+    if(!candidate)
+    {
+      candidate = find_candidate<RetType, 0, candidates>(*record);
+      g_storage.set_plan(hash, call, *candidate);
+    }
+
+    function = copy_candidate_function<RetType, 0, candidates>(*candidate, *record);
+    return *candidate;
+  }
+
+  //
+  // index of the first candidate signature registered in record, the number of candidates if none
+  //
+  template <typename RetType, size_t Index, typename Candidates>
+  static uint32_t find_candidate(detail::key_record& record)
+  {
+    if constexpr(Index == std::tuple_size_v<Candidates>)
+    {
+      return Index;
+    }
+    else
+    {
+      if(find_candidate_function<RetType>(std::tuple_element_t<Index, Candidates>(), record))
+      {
+        return Index;
+      }
+      return find_candidate<RetType, Index + 1, Candidates>(record);
+    }
+  }
+
+  template <typename RetType, typename... Params>
+  static detail::erased_function* find_candidate_function(void (*)(Params...), detail::key_record& record)
+  {
+    return record.find(get_signature<RetType, Params...>());
+  }
+
+  // a copy of the function registered in record for the candidate signature, empty if none
+  template <typename RetType, size_t Index, typename Candidates>
+  static detail::erased_function copy_candidate_function(uint32_t candidate, detail::key_record& record)
+  {
+    if constexpr(Index == std::tuple_size_v<Candidates>)
+    {
+      return {};
+    }
+    else
+    {
+      if(candidate == Index)
+      {
+        auto found = find_candidate_function<RetType>(std::tuple_element_t<Index, Candidates>(), record);
+        return found ? *found : detail::erased_function{};
+      }
+      return copy_candidate_function<RetType, Index + 1, Candidates>(candidate, record);
+    }
+  }
+
+  template <typename RetType, size_t Index, typename Candidates, typename... Args>
+  static RetType make_candidate(size_t candidate, const detail::erased_function& function, Args&&... args)
+  {
+    if constexpr(Index == std::tuple_size_v<Candidates>)
+    {
+      return error_policy::template not_found<RetType>("Registry not found");
+    }
+    else
+    {
+      if(candidate == Index)
+      {
+        return make_converted<RetType>(std::tuple_element_t<Index, Candidates>(), function, std::forward<Args>(args)...);
+      }
+      return make_candidate<RetType, Index + 1, Candidates>(candidate, function, std::forward<Args>(args)...);
+    }
+  }
+
+  template <typename RetType, typename... Params, typename... Args>
+  static RetType make_converted(void (*)(Params...), const detail::erased_function& function, Args&&... args)
+  {
+    auto thunk = reinterpret_cast<thunk_type<RetType, Params...>>(function.thunk);
+
+    return error_policy::template invoke<RetType>(thunk,
+      function.state.get(),
+      detail::make_arg_ref(detail::convert_arg<Params, Args>(args))...);
+  }
+
+  //
+  // call the functions registered for RetType(Args...) in the order the keys were registered and
+  // return the first valid object
+  //
+  template <typename RetType, typename... Args>
+  static RetType try_make_impl(Args&&... args)
+  {
+    instrumentation_scope scope(detail::make_call{0, detail::signature_info<RetType, Args...>(), true});
+
+    load_section_entries();
+
+    // copied under the lock and called once it is released, as in make_impl
+    std::vector<detail::erased_function> functions;
+    {
+      read_lock lock(g_mutex);
+      scope.locked();
+
+      auto signature = get_signature<RetType, Args...>();
+      for(auto&& [_, record] : g_storage.index())
+      {
+        if(auto function = record.find(signature))
+        {
+          functions.push_back(*function);
+        }
+      }
+    }
+
+    std::exception_ptr eptr;
+
+    for(auto& func : functions)
+    {
+      auto thunk = reinterpret_cast<thunk_type<RetType, Args...>>(func.thunk);
+
+      try
+      {
+        if constexpr(std::is_same_v<RetType, base_type>)
+        {
+          return thunk(func.state.get(), detail::make_arg_ref(detail::decay_arg<Args>(args))...);
+        }
+        else
+        {
+          auto obj = thunk(func.state.get(), detail::make_arg_ref(detail::decay_arg<Args>(args))...);
+          if(obj)
+          {
+            return obj;
+          }
+        }
+      }
+      catch(...)
+      {
+        eptr = std::current_exception();
+      }
+    }
 
     if(eptr)
     {
-      std::rethrow_exception(eptr);
+      return error_policy::template failed<RetType>(eptr);
+    }
+    else if constexpr(std::is_default_constructible_v<RetType>)
+    {
+      return RetType();
+    }
+    else
+    {
+      return error_policy::template not_found<RetType>("no valid registery is found");
+    }
+  }
+
+  template <typename ConcreteType, typename... Args>
+  static void register_type_impl(const key_type& key)
+  {
+    auto hash = g_hash_function(key);
+
+    registration_scope scope(registration_of<ConcreteType, Args...>(hash, key));
+
+    if constexpr(std::is_convertible_v<ConcreteType, base_type>)
+    {
+      set_function<base_type, Args...>(hash, &detail::construct<base_type, ConcreteType, Args...>);
+    }
+    else if constexpr(std::is_base_of_v<base_type, ConcreteType>)
+    {
+      set_function<base_type*, Args...>(hash, &detail::construct<base_type*, ConcreteType, Args...>);
+      set_function<std::shared_ptr<base_type>, Args...>(hash,
+        &detail::construct<std::shared_ptr<base_type>, ConcreteType, Args...>);
+      set_function<std::unique_ptr<base_type>, Args...>(hash,
+        &detail::construct<std::unique_ptr<base_type>, ConcreteType, Args...>);
     }
     else
     {
-      return nullptr;
+      static_assert(false, "Invalid type");
+    }
+  }
+
+  template <typename Alternative, typename... Args>
+  static void register_alternative_impl(const key_type& key)
+  {
+    if constexpr(std::is_constructible_v<Alternative, Args&&...>)
+    {
+      auto hash = g_hash_function(key);
+
+      registration_scope scope(registration_of<Alternative, Args...>(hash, key));
+
+      set_function<base_type, Args...>(hash, &detail::construct<base_type, Alternative, Args...>);
+    }
+  }
+
+  template <typename Range>
+  static void register_functions_impl(const Range& functions)
+  {
+    for(auto&& [key, func] : functions)
+    {
+      register_function_impl(key, func);
     }
   }
 
   //
-  // make shared_ptr
+  // the signature of func is deduced as with std::function, without instantiating its machinery
   //
+  template <typename Func>
+  static void register_function_impl(const key_type& key, Func&& func)
+  {
+    register_function_impl(key, std::forward<Func>(func), static_cast<decltype(std::function(func))*>(nullptr));
+  }
 
-  //
-  // try to make a shared pointer of base_type using the key and args
-  // returns nullptr if no valid registry is found
-  //
-  template <typename... Args>
-  static std::shared_ptr<base_type> make_shared(const key_type& key, Args&&... args)
+  template <typename Func, typename ReturnType, typename... Args>
+  static void register_function_impl(const key_type& key, Func&& func, std::function<ReturnType(Args...)>*)
   {
-    std::lock_guard lock(g_mutex);
+    using func_type = std::decay_t<Func>;
 
     auto hash = g_hash_function(key);
 
-    auto it = get_registry<std::shared_ptr<base_type>, Args...>().find(hash);
+    registration_scope scope(registration_of<ReturnType, Args...>(hash, key));
+
+    auto state = detail::make_state<func_type>(std::forward<Func>(func));
 
-    if(it == get_registry<std::shared_ptr<base_type>, Args...>().end())
+    if constexpr(std::is_convertible_v<ReturnType, base_type>)
     {
-      throw std::runtime_error("Registry not found");
+      set_function<base_type, Args...>(hash, &detail::invoke_callable<base_type, func_type, Args...>, state);
+    }
+    else if constexpr(std::is_convertible_v<ReturnType, base_type*>)
+    {
+      set_function<base_type*, Args...>(hash, &detail::invoke_callable<base_type*, func_type, Args...>, state);
+    }
+    else if constexpr(detail::is_specialization_of_v<ReturnType, std::shared_ptr> &&
+      std::is_base_of_v<base_type, typename detail::get_template_arg_type_of<ReturnType>::template arg<0>::type>)
+    {
+      set_function<std::shared_ptr<base_type>, Args...>(hash,
+        &detail::invoke_callable<std::shared_ptr<base_type>, func_type, Args...>,
+        state);
+    }
+    else if constexpr(detail::is_specialization_of_v<ReturnType, std::unique_ptr> &&
+      std::is_base_of_v<base_type, typename detail::get_template_arg_type_of<ReturnType>::template arg<0>::type>)
+    {
+      set_function<std::unique_ptr<base_type>, Args...>(hash,
+        &detail::invoke_callable<std::unique_ptr<base_type>, func_type, Args...>,
+        state);
+    }
+    else
+    {
+      static_assert(false, "Invalid function return type");
     }
-
-    return it->second(std::forward<Args>(args)...);
   }
 
   //
-  // try to make a shared pointer using ConcreteType and cast it to
-  // std::shared_ptr<ConcreteType> returns nullptr if no valid registry is found
+  // erase func from the signature register_function_impl stored it for. the write lock must be held
   //
-  template <typename ConcreteType, typename... Args>
-  static std::shared_ptr<ConcreteType> make_shared(Args&&... args)
+  template <typename Func>
+  static bool unregister_function_impl(const key_type& key, const Func& func)
   {
-    std::lock_guard lock(g_mutex);
-
-    auto hash = typeid(ConcreteType).hash_code();
+    return unregister_function_impl(key, func, static_cast<decltype(std::function(func))*>(nullptr));
+  }
 
-    auto it = get_registry<std::shared_ptr<base_type>, Args...>().find(hash);
+  template <typename Func, typename ReturnType, typename... Args>
+  static bool unregister_function_impl(const key_type& key, const Func& func, std::function<ReturnType(Args...)>*)
+  {
+    auto hash = g_hash_function(key);
 
-    if(it == get_registry<std::shared_ptr<base_type>, Args...>().end())
+    if constexpr(std::is_convertible_v<ReturnType, base_type>)
     {
-      throw std::runtime_error("Registry not found");
+      return erase_function<base_type, Func, Args...>(hash, func);
+    }
+    else if constexpr(std::is_convertible_v<ReturnType, base_type*>)
+    {
+      return erase_function<base_type*, Func, Args...>(hash, func);
+    }
+    else if constexpr(detail::is_specialization_of_v<ReturnType, std::shared_ptr>)
+    {
+      return erase_function<std::shared_ptr<base_type>, Func, Args...>(hash, func);
+    }
+    else
+    {
+      return erase_function<std::unique_ptr<base_type>, Func, Args...>(hash, func);
     }
-
-    return std::static_pointer_cast<ConcreteType>(it->second(std::forward<Args>(args)...));
   }
 
   //
-  // loop through all the registered keys and try to make a shared pointer of base_type using the provided args
-  // returns nullptr if no valid registry is found
+  // erase the function registered under hash for RetType(Args...) if it is a Func equal to func.
+  // the write lock must be held
   //
-  template <typename... Args>
-  static std::shared_ptr<base_type> try_make_shared(Args&&... args)
+  template <typename RetType, typename Func, typename... Args>
+  static bool erase_function(size_t hash, const Func& func)
   {
-    std::lock_guard lock(g_mutex);
-
-    std::exception_ptr eptr;
+    auto signature = get_signature<RetType, Args...>();
+    auto function  = g_storage.find(hash, signature);
+    auto thunk     = reinterpret_cast<void (*)()>(&detail::invoke_callable<RetType, Func, Args...>);
 
-    for(auto&& [_, func] : get_registry<std::shared_ptr<base_type>, Args...>())
+    if(!function || function->thunk != thunk || !(*static_cast<const Func*>(function->state.get()) == func))
     {
-      try
-      {
-        auto obj = func(std::forward<Args>(args)...);
-        if(obj)
-        {
-          return obj;
-        }
-      }
-      catch(...)
-      {
-        eptr = std::current_exception();
-      }
+      return false;
     }
 
-    if(eptr)
-    {
-      std::rethrow_exception(eptr);
-    }
-    else
-    {
-      return nullptr;
-    }
+    g_storage.erase(hash, signature);
+    return true;
   }
 
   //
-  // make unique_ptr
+  // the registration of Type under key for Args, given to the instrumentation policy
   //
+  template <typename Type, typename... Args>
+  static detail::register_call registration_of(size_t hash, const key_type& key)
+  {
+    return {hash, detail::key_view(key), typeid(Type), detail::signature_info<void, Args...>(), typeid(static_factory), &usage};
+  }
 
   //
-  // try to make a unique pointer of base_type using the key and args
-  // returns nullptr if no valid registry is found
+  // the size of the registry. the lock must be held
   //
-  template <typename... Args>
-  static std::unique_ptr<base_type> make_unique(const key_type& key, Args&&... args)
+  static registry_usage usage()
   {
-    std::lock_guard lock(g_mutex);
+    return g_storage.usage();
+  }
 
-    auto hash = g_hash_function(key);
+  //
+  // store thunk under hash in the registry of RetType(Args...). the write lock must be held
+  //
+  template <typename RetType, typename... Args>
+  static void set_function(size_t hash, thunk_type<RetType, Args...> thunk, detail::function_state state = {})
+  {
+    g_storage.set(hash,
+      get_signature<RetType, Args...>(),
+      {reinterpret_cast<void (*)()>(thunk), std::move(state.object), state.ops});
+  }
 
-    auto it = get_registry<std::unique_ptr<base_type>, Args...>().find(hash);
+  //
+  // install the entries registered with STATIC_FACTORY_REGISTER in one pass, on first use.
+  // default visibility: with STATIC_FACTORY_DECLARE, the other libraries call the copy of the
+  // library owning the registry, which must export it
+  //
+  static void load_section_entries()
+  {
+    detail::load_section_entries<static_factory>([] { return write_lock(g_mutex); });
+  }
 
-    if(it == get_registry<std::unique_ptr<base_type>, Args...>().end())
-    {
-      throw std::runtime_error("Registry not found");
-    }
+  //
+  // id of the signature RetType(Args...), assigned on the first call with the lock held, read or
+  // write. the ids are never reassigned, so the id is kept for the next calls without locking
+  //
+  template <typename RetType, typename... Args>
+  static uint32_t get_signature()
+  {
+    static const uint32_t signature = g_storage.signature_id(detail::signature_of<RetType, Args...>());
 
-    return it->second(std::forward<Args>(args)...);
+    return signature;
   }
 
   //
-  // try to make a unique pointer using ConcreteType and cast it to
-  // std::unique_ptr<ConcreteType> returns nullptr if no valid registry is found
+  // function registered under hash for RetType(Args...), nullptr if none. the read lock must be held
   //
-  template <typename ConcreteType, typename... Args>
-  static std::unique_ptr<ConcreteType> make_unique(Args&&... args)
+  template <typename RetType, typename... Args>
+  static detail::erased_function* find_function(size_t hash)
   {
-    std::lock_guard lock(g_mutex);
+    return g_storage.find(hash, get_signature<RetType, Args...>());
+  }
 
-    auto hash = typeid(ConcreteType).hash_code();
+  static inline const typename Policies::hash g_hash_function{};
+  static storage_type g_storage;
 
-    auto it = get_registry<std::unique_ptr<base_type>, Args...>().find(hash);
+  static mutex_type g_mutex;
+};
 
-    if(it == get_registry<std::unique_ptr<base_type>, Args...>().end())
-    {
-      throw std::runtime_error("Registry not found");
-    }
+template <typename base_type, typename key_type, typename policies_type>
+typename static_factory<base_type, key_type, policies_type>::storage_type
+  static_factory<base_type, key_type, policies_type>::g_storage;
+
+template <typename base_type, typename key_type, typename policies_type>
+typename static_factory<base_type, key_type, policies_type>::mutex_type
+  static_factory<base_type, key_type, policies_type>::g_mutex;
+
+//
+// pin the registry of a factory in one library, so that all the libraries share a single table:
+// STATIC_FACTORY_DECLARE(Pet, std::string); in a header seen by every library, and
+// STATIC_FACTORY_DEFINE(Pet, std::string); in one source file of the library owning the registry.
+// the base type and key type must be exported (default visibility) as well.
+// on Windows, define STATIC_FACTORY_EXPORTS when building the library owning the registry: the
+// other libraries import it
+//
+#if defined(_WIN32)
+#if defined(STATIC_FACTORY_EXPORTS)
+#define STATIC_FACTORY_API __declspec(dllexport)
+#else
+#define STATIC_FACTORY_API __declspec(dllimport)
+#endif
+#elif defined(__GNUC__)
+#define STATIC_FACTORY_API __attribute__((visibility("default")))
+#else
+#define STATIC_FACTORY_API
+#endif
+
+#define STATIC_FACTORY_DECLARE(...) extern template class STATIC_FACTORY_API static_factory<__VA_ARGS__>
+
+#if defined(_WIN32)
+#define STATIC_FACTORY_DEFINE(...) template class STATIC_FACTORY_API static_factory<__VA_ARGS__>
+#else
+#define STATIC_FACTORY_DEFINE(...) template class static_factory<__VA_ARGS__>
+#endif
+
+//
+// skip the instantiation of a factory, or of the registry storage shared by the factories of a
+// storage policy, in the translation units that include this, and instantiate it once in a
+// source file instead. e.g:
+// STATIC_FACTORY_EXTERN_TEMPLATE(Pet, std::string); in a header, and
+// STATIC_FACTORY_INSTANTIATE_TEMPLATE(Pet, std::string); in one source file.
+//
+#define STATIC_FACTORY_EXTERN_TEMPLATE(...) extern template class static_factory<__VA_ARGS__>
+
+#define STATIC_FACTORY_INSTANTIATE_TEMPLATE(...) template class static_factory<__VA_ARGS__>
+
+#define STATIC_FACTORY_EXTERN_STORAGE(Storage) extern template class detail::registry_storage<Storage>
+
+#define STATIC_FACTORY_INSTANTIATE_STORAGE(Storage) template class detail::registry_storage<Storage>
+
+//
+// register ConcreteType (constructible from the optional Args) under key in the factory of Base
+// without static initialization: the entry is a constant placed in a dedicated ELF section and
+// the factory installs all the entries in one pass on first use.
+// must be used at namespace scope. e.g: STATIC_FACTORY_REGISTER(Pet, "Dog", Dog, std::string);
+//
+#define STATIC_FACTORY_REGISTER(Base, key, ConcreteType, ...) \
+  STATIC_FACTORY_REGISTER_IN(static_factory<Base>, key, ConcreteType __VA_OPT__(, ) __VA_ARGS__)
+
+//
+// same as STATIC_FACTORY_REGISTER for a factory with a custom key type. e.g:
+// STATIC_FACTORY_REGISTER_IN((static_factory<Pet, std::string_view>), "Dog", Dog);
+//
+#if defined(__ELF__)
+#define STATIC_FACTORY_REGISTER_IN(Factory, key, ConcreteType, ...)                           \
+  __attribute__((used, section(STATIC_FACTORY_STRINGIFY(STATIC_FACTORY_SECTION_NAME))))      \
+  static constexpr detail::section_entry STATIC_FACTORY_CONCAT(g_static_factory_entry_,      \
+    __COUNTER__) = {&typeid(STATIC_FACTORY_UNPARENTHESIZE(Factory)),                          \
+    &typeid(ConcreteType),                                                                    \
+    key,                                                                                      \
+    &detail::section_registrar<STATIC_FACTORY_UNPARENTHESIZE(Factory),                        \
+      ConcreteType __VA_OPT__(, ) __VA_ARGS__>::install}
+#else
+#define STATIC_FACTORY_REGISTER_IN(Factory, key, ConcreteType, ...)                           \
+  static const detail::section_registrar<STATIC_FACTORY_UNPARENTHESIZE(Factory),              \
+    ConcreteType __VA_OPT__(, ) __VA_ARGS__>                                                  \
+    STATIC_FACTORY_CONCAT(g_static_factory_entry_, __COUNTER__)                               \
+  {                                                                                           \
+    key                                                                                       \
+  }
+#endif
 
-    auto obj = it->second(std::forward<Args>(args)...);
+/**
+ * \brief An entry of a constexpr_factory: ConcreteType registered under Key.
+ */
+template <detail::fixed_string Key, typename ConcreteType>
+struct constexpr_entry
+{
+  using concrete_type = ConcreteType;
 
-    return std::unique_ptr<ConcreteType>(static_cast<ConcreteType*>(obj.release()));
+  static constexpr std::string_view key = Key.view();
+};
+
+/**
+ * \brief The constexpr_factory class provides a compile time registry of literal types.
+ *
+ * The registry is the list of entries given as template arguments, so no registration
+ * happens at runtime. When the registered types are literal types, make<"key">(args...)
+ * and make(key, args...) can be evaluated at compile time, so the created objects can be
+ * baked into read-only data.
+ *
+ * e.g:
+ *  using shape_factory = constexpr_factory<Shape, constexpr_entry<"circle", Circle>, constexpr_entry<"square", Square>>;
+ *  constexpr Shape shape = shape_factory::make<"circle">(2.0);
+ *
+ * \tparam BaseType The type constructible from every registered type.
+ * \tparam Entries The constexpr_entry list.
+ */
+template <typename BaseType, typename... Entries>
+class constexpr_factory
+{
+  public:
+  using base_type = BaseType;
+
+  static_assert((std::is_convertible_v<typename Entries::concrete_type, base_type> && ...),
+    "Invalid type");
+
+  //
+  // returns true if Key is registered
+  //
+  template <detail::fixed_string Key>
+  static constexpr bool contains()
+  {
+    return ((Entries::key == Key.view()) || ...);
   }
 
   //
-  // loop through all the registered keys and try to make a unique pointer of base_type using the provided args
-  // returns nullptr if no valid registry is found
+  // returns true if key is registered
   //
-  template <typename... Args>
-  static std::unique_ptr<base_type> try_make_unique(Args&&... args)
+  static constexpr bool contains(std::string_view key)
   {
-    std::lock_guard lock(g_mutex);
+    return ((Entries::key == key) || ...);
+  }
 
-    std::exception_ptr eptr;
-    for(auto&& [_, func] : get_registry<std::unique_ptr<base_type>, Args...>())
-    {
-      try
-      {
-        auto obj = func(std::forward<Args>(args)...);
-        if(obj)
-        {
-          return obj;
-        }
-      }
-      catch(...)
-      {
-        eptr = std::current_exception();
-      }
-    }
+  //
+  // make instance of base_type using the type registered under Key, resolved at compile time
+  //
+  template <detail::fixed_string Key, typename... Args>
+  static constexpr base_type make(Args&&... args)
+  {
+    static_assert(contains<Key>(), "Registry not found");
 
-    if(eptr)
+    return make_impl<Key, Entries...>(std::forward<Args>(args)...);
+  }
+
+  //
+  // make instance of base_type using the type registered under key and constructible from args
+  // throws std::runtime_error (a compile error in a constant expression) if no valid registry is found
+  //
+  template <typename... Args>
+  static constexpr base_type make(std::string_view key, Args&&... args)
+  {
+    if constexpr(sizeof...(Entries) > 0)
     {
-      std::rethrow_exception(eptr);
+      return find_and_make<Entries...>(key, std::forward<Args>(args)...);
     }
     else
     {
-      return nullptr;
+      throw std::runtime_error("Registry not found");
     }
   }
 
   private:
-  static_factory() = delete;
+  constexpr_factory() = delete;
 
-  template <typename ReturnType, typename... Args>
-  static void register_function_impl(const key_type& key,
-    std::function<ReturnType(Args...)>&& func)
+  template <detail::fixed_string Key, typename Entry, typename... Rest, typename... Args>
+  static constexpr base_type make_impl(Args&&... args)
   {
-    static_assert(detail::is_related_v<base_type, ReturnType>, "Invalid function return type");
-
-    std::lock_guard lock(g_mutex);
-
-    auto hash = g_hash_function(key);
-
-    if constexpr(std::is_convertible_v<ReturnType, base_type>)
+    if constexpr(Entry::key == Key.view())
     {
-      get_registry<base_type, Args...>()[hash] = std::move(func);
+      return base_type(typename Entry::concrete_type(std::forward<Args>(args)...));
     }
-    else if constexpr(std::is_convertible_v<ReturnType, base_type*>)
+    else
     {
-      get_registry<base_type*, Args...>()[hash] = std::move(func);
+      return make_impl<Key, Rest...>(std::forward<Args>(args)...);
     }
-    else if constexpr(detail::is_specialization_of_v<ReturnType, std::shared_ptr> &&
-      std::is_base_of_v<base_type, typename detail::get_template_arg_type_of<ReturnType>::template arg<0>::type>)
+  }
+
+  template <typename Entry, typename... Rest, typename... Args>
+  static constexpr base_type find_and_make(std::string_view key, Args&&... args)
+  {
+    if constexpr(std::is_constructible_v<typename Entry::concrete_type, Args&&...>)
     {
-      get_registry<std::shared_ptr<base_type>, Args...>()[hash] = std::move(func);
+      if(Entry::key == key)
+      {
+        return base_type(typename Entry::concrete_type(std::forward<Args>(args)...));
+      }
     }
-    else if constexpr(detail::is_specialization_of_v<ReturnType, std::unique_ptr> &&
-      std::is_base_of_v<base_type, typename detail::get_template_arg_type_of<ReturnType>::template arg<0>::type>)
+
+    if constexpr(sizeof...(Rest) > 0)
     {
-      get_registry<std::unique_ptr<base_type>, Args...>()[hash] = std::move(func);
+      return find_and_make<Rest...>(key, std::forward<Args>(args)...);
     }
     else
     {
-      static_assert(false, "Invalid function return type");
+      throw std::runtime_error("Registry not found");
     }
   }
+};
 
-  template <typename RetType, typename... Args>
-  static auto& get_registry()
+/**
+ * \brief The generated_factory class creates the types of a registry generated at build time.
+ *
+ * The Registry is generated by the static_factory_generate() cmake function from a manifest.
+ * It provides the keys ordered by their slot in a minimal perfect hash table, the seeds of the
+ * table and a visit(slot, visitor) function that switches over the slots, so a lookup hashes
+ * the key twice, compares it once and calls the constructor directly. No registration happens
+ * at runtime.
+ *
+ * \tparam Registry The generated registry.
+ */
+template <typename Registry>
+class generated_factory
+{
+  public:
+  using base_type = typename Registry::base_type;
+
+  static constexpr size_t npos = static_cast<size_t>(-1);
+
+  //
+  // slot of key in the perfect hash table, npos if key is not registered
+  //
+  static constexpr size_t find(std::string_view key)
   {
-    return g_registry<RetType, std::decay_t<Args>...>;
+    auto bucket = detail::fnv1a(key, 0) % Registry::seeds.size();
+    auto slot   = detail::fnv1a(key, Registry::seeds[bucket]) % Registry::keys.size();
+
+    return Registry::keys[slot] == key ? slot : npos;
   }
 
-  static constexpr auto g_hash_function = std::hash<key_type>();
-  template <typename RetType, typename... Args>
-  static detail::unordered_flat_map<size_t, typename std::function<RetType(Args...)>> g_registry;
+  static constexpr bool contains(std::string_view key)
+  {
+    return find(key) != npos;
+  }
 
-  static std::mutex g_mutex;
-};
+  static constexpr const auto& keys()
+  {
+    return Registry::keys;
+  }
 
-template <typename base_type, typename key_type>
-template <typename RetType, typename... Args>
-detail::unordered_flat_map<size_t, typename std::function<RetType(Args...)>>
-  static_factory<base_type, key_type>::g_registry; // TODO: replace with std::flat_map
+  //
+  // make instance of base_type using the type generated for key and args
+  // throws std::runtime_error if key is not registered or its type is not constructible from args
+  //
+  template <typename... Args>
+    requires(!std::is_abstract_v<base_type>)
+  static base_type make(std::string_view key, Args&&... args)
+  {
+    return visit<base_type, Args...>(key,
+      [&]<typename ConcreteType>(std::type_identity<ConcreteType>) -> base_type
+      {
+        if constexpr(std::is_convertible_v<ConcreteType, base_type>)
+        {
+          return ConcreteType(std::forward<Args>(args)...);
+        }
+        else
+        {
+          throw std::runtime_error("Registry not found");
+        }
+      });
+  }
+
+  template <typename... Args>
+  static base_type* make_ptr(std::string_view key, Args&&... args)
+  {
+    return visit<base_type*, Args...>(key,
+      [&]<typename ConcreteType>(std::type_identity<ConcreteType>) -> base_type*
+      {
+        if constexpr(std::is_base_of_v<base_type, ConcreteType>)
+        {
+          return new ConcreteType(std::forward<Args>(args)...);
+        }
+        else
+        {
+          throw std::runtime_error("Registry not found");
+        }
+      });
+  }
+
+  template <typename... Args>
+  static std::shared_ptr<base_type> make_shared(std::string_view key, Args&&... args)
+  {
+    return visit<std::shared_ptr<base_type>, Args...>(key,
+      [&]<typename ConcreteType>(std::type_identity<ConcreteType>) -> std::shared_ptr<base_type>
+      {
+        if constexpr(std::is_base_of_v<base_type, ConcreteType>)
+        {
+          return std::make_shared<ConcreteType>(std::forward<Args>(args)...);
+        }
+        else
+        {
+          throw std::runtime_error("Registry not found");
+        }
+      });
+  }
+
+  template <typename... Args>
+  static std::unique_ptr<base_type> make_unique(std::string_view key, Args&&... args)
+  {
+    return visit<std::unique_ptr<base_type>, Args...>(key,
+      [&]<typename ConcreteType>(std::type_identity<ConcreteType>) -> std::unique_ptr<base_type>
+      {
+        if constexpr(std::is_base_of_v<base_type, ConcreteType>)
+        {
+          return std::make_unique<ConcreteType>(std::forward<Args>(args)...);
+        }
+        else
+        {
+          throw std::runtime_error("Registry not found");
+        }
+      });
+  }
 
-template <typename base_type, typename key_type>
-std::mutex static_factory<base_type, key_type>::g_mutex;
+  private:
+  generated_factory() = delete;
+
+  template <typename RetType, typename... Args, typename Make>
+  static RetType visit(std::string_view key, Make&& make)
+  {
+    auto slot = find(key);
+
+    if(slot == npos)
+    {
+      throw std::runtime_error("Registry not found");
+    }
+
+    return Registry::visit(slot,
+      [&]<typename ConcreteType>(std::type_identity<ConcreteType> type) -> RetType
+      {
+        if constexpr(std::is_constructible_v<ConcreteType, Args&&...>)
+        {
+          return make(type);
+        }
+        else
+        {
+          throw std::runtime_error("Registry not found");
+        }
+      });
+  }
+};
 
 #endif // STATIC_FACTORY_H
\ No newline at end of file
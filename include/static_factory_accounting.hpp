@@ -0,0 +1,455 @@
+#ifndef STATIC_FACTORY_ACCOUNTING_H
+#define STATIC_FACTORY_ACCOUNTING_H
+
+#include "static_factory.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace detail
+{
+
+// the objects of one key counted by one thread. the objects may be destroyed by another thread
+// than the one that made them: live and bytes are signed and only meaningful summed
+struct account_counters
+{
+  std::atomic<int64_t> made  = 0;
+  std::atomic<int64_t> live  = 0;
+  std::atomic<int64_t> bytes = 0;
+
+  // increment without a locked instruction, the thread is the only writer
+  static void add(std::atomic<int64_t>& counter, int64_t value)
+  {
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+  }
+};
+
+// the counters of the accounts of one thread, in blocks allocated on first use so that they
+// never move while snapshot() reads them
+class thread_accounts
+{
+  public:
+  static constexpr size_t block_size  = 256;
+  static constexpr size_t block_count = 1024;
+
+  using block = std::array<account_counters, block_size>;
+
+  thread_accounts() = default;
+
+  thread_accounts(const thread_accounts&)            = delete;
+  thread_accounts& operator=(const thread_accounts&) = delete;
+
+  ~thread_accounts()
+  {
+    for(auto& b : m_blocks)
+    {
+      delete b.load(std::memory_order_relaxed);
+    }
+  }
+
+  // written by the owner thread only
+  account_counters& at(uint32_t account)
+  {
+    auto& b = m_blocks[account / block_size];
+    auto p  = b.load(std::memory_order_relaxed);
+    if(!p)
+    {
+      p = new block;
+      b.store(p, std::memory_order_release);
+    }
+    return (*p)[account % block_size];
+  }
+
+  // nullptr if the thread never counted the account
+  const account_counters* find(uint32_t account) const
+  {
+    auto p = m_blocks[account / block_size].load(std::memory_order_acquire);
+    return p ? &(*p)[account % block_size] : nullptr;
+  }
+
+  private:
+  std::array<std::atomic<block*>, block_count> m_blocks{};
+};
+
+} // namespace detail
+
+/**
+ * \brief The live objects of a key, counted by accounted_factory.
+ */
+template <typename KeyType>
+struct key_account
+{
+  KeyType key;
+  size_t size   = 0; // bytes of the registered type, 0 if unknown (a registered function)
+  int64_t made  = 0; // objects made while the accounting was enabled
+  int64_t live  = 0; // of them, the ones not destroyed yet
+  int64_t bytes = 0; // bytes held by the live objects
+};
+
+/**
+ * \brief The accounted_factory class counts the live objects of each key of a static_factory.
+ *
+ * The objects made through it while the accounting is enabled are counted per key: make_unique
+ * and make_shared return pointers with a tracking deleter, the raw pointers of make_ptr must be
+ * released with destroy. The counts are kept in counters of the thread making or destroying the
+ * object, without locking them, and summed by snapshot(). Each thread caches the accounts of the
+ * keys it uses, so that counting an object takes no lock once its key was seen by the thread.
+ * The accounts are told apart by key, not only by hash: keys whose hashes collide are counted apart.
+ *
+ * The bytes of an object are the size of the type registered under its key with register_type.
+ * The keys registered with register_function, or directly in the factory, are counted with 0 bytes.
+ *
+ * While the accounting is disabled, the pointers carry an empty deleter and the cost of a call is
+ * one relaxed load. The objects made while it is disabled are never counted, even when destroyed
+ * after it is enabled, except the ones of make_ptr: destroy them while the accounting is in the
+ * state they were made in.
+ *
+ * \tparam Factory The static_factory to make the objects with.
+ */
+template <typename Factory>
+class accounted_factory
+{
+  public:
+  using base_type = typename Factory::base_type;
+  using key_type  = typename Factory::key_type;
+
+  static constexpr uint32_t no_account = UINT32_MAX;
+
+  struct deleter
+  {
+    uint32_t account = no_account;
+    uint32_t size    = 0;
+
+    void operator()(base_type* obj) const
+    {
+      if(account != no_account)
+      {
+        count(account, 0, -1, -int64_t(size));
+      }
+      delete obj;
+    }
+  };
+
+  using unique_ptr = std::unique_ptr<base_type, deleter>;
+
+  static void enable(bool enabled = true)
+  {
+    s_enabled.store(enabled, std::memory_order_relaxed);
+  }
+
+  static bool enabled()
+  {
+    return s_enabled.load(std::memory_order_relaxed);
+  }
+
+  //
+  // register ConcreteType in the factory, accounted with its size
+  //
+  template <typename ConcreteType, typename... Args>
+  static void register_type(const key_type& key)
+  {
+    Factory::template register_type<ConcreteType, Args...>(key);
+    account_of(Factory::prepare(key).hash, key, sizeof(ConcreteType));
+  }
+
+  template <typename Func>
+  static void register_function(const key_type& key, Func&& func)
+  {
+    Factory::register_function(key, std::forward<Func>(func));
+    account_of(Factory::prepare(key).hash, key, 0);
+  }
+
+  template <typename... Args>
+  static unique_ptr make_unique(const key_type& key, Args&&... args)
+  {
+    if(!enabled())
+    {
+      return unique_ptr(Factory::make_unique(key, std::forward<Args>(args)...).release());
+    }
+
+    auto prepared = Factory::prepare(key);
+    auto obj      = Factory::make_unique(prepared, std::forward<Args>(args)...);
+    auto d        = made(prepared.hash, key, obj != nullptr);
+    return unique_ptr(obj.release(), d);
+  }
+
+  //
+  // the object of Factory::make_shared, held by the deleter of the returned pointer
+  //
+  template <typename... Args>
+  static std::shared_ptr<base_type> make_shared(const key_type& key, Args&&... args)
+  {
+    if(!enabled())
+    {
+      return Factory::make_shared(key, std::forward<Args>(args)...);
+    }
+
+    auto prepared = Factory::prepare(key);
+    auto obj      = Factory::make_shared(prepared, std::forward<Args>(args)...);
+    auto d        = made(prepared.hash, key, obj != nullptr);
+    if(d.account == no_account)
+    {
+      return obj;
+    }
+
+    auto raw = obj.get();
+    return std::shared_ptr<base_type>(raw,
+      [d, obj = std::move(obj)](base_type*) mutable
+      {
+        count(d.account, 0, -1, -int64_t(d.size));
+        obj.reset();
+      });
+  }
+
+  //
+  // make a raw pointer to release with destroy(key, obj)
+  //
+  template <typename... Args>
+  static base_type* make_ptr(const key_type& key, Args&&... args)
+  {
+    if(!enabled())
+    {
+      return Factory::make_ptr(key, std::forward<Args>(args)...);
+    }
+
+    auto prepared = Factory::prepare(key);
+    auto obj      = Factory::make_ptr(prepared, std::forward<Args>(args)...);
+    made(prepared.hash, key, obj != nullptr);
+    return obj;
+  }
+
+  //
+  // delete obj, made by make_ptr(key, ...)
+  //
+  static void destroy(const key_type& key, base_type* obj)
+  {
+    if(obj && enabled())
+    {
+      auto d = deleter_of(Factory::prepare(key).hash, key);
+      count(d.account, 0, -1, -int64_t(d.size));
+    }
+    delete obj;
+  }
+
+  //
+  // the counts of every accounted key, summed over all the threads, in order of first accounting
+  //
+  static std::vector<key_account<key_type>> snapshot()
+  {
+    std::vector<key_account<key_type>> result;
+
+    std::scoped_lock lock(s_threads_mutex);
+    std::shared_lock accounts_lock(s_accounts_mutex);
+
+    for(uint32_t account = 0; account < s_accounts.size(); ++account)
+    {
+      auto& entry = result.emplace_back(s_accounts[account]);
+      if(account < s_retired.size())
+      {
+        entry.made += s_retired[account].made;
+        entry.live += s_retired[account].live;
+        entry.bytes += s_retired[account].bytes;
+      }
+
+      for(auto& thread : s_threads)
+      {
+        if(auto counters = thread->find(account))
+        {
+          entry.made += counters->made.load(std::memory_order_relaxed);
+          entry.live += counters->live.load(std::memory_order_relaxed);
+          entry.bytes += counters->bytes.load(std::memory_order_relaxed);
+        }
+      }
+    }
+    return result;
+  }
+
+  private:
+  struct retired_counts
+  {
+    int64_t made  = 0;
+    int64_t live  = 0;
+    int64_t bytes = 0;
+  };
+
+  // registers the counters of the thread, merged into the retired counts at the thread exit
+  struct thread_owner
+  {
+    std::shared_ptr<detail::thread_accounts> accounts = std::make_shared<detail::thread_accounts>();
+
+    thread_owner()
+    {
+      std::lock_guard lock(s_threads_mutex);
+      s_threads.push_back(accounts);
+    }
+
+    ~thread_owner()
+    {
+      std::lock_guard lock(s_threads_mutex);
+      std::shared_lock accounts_lock(s_accounts_mutex);
+
+      s_retired.resize(std::max(s_retired.size(), s_accounts.size()));
+      for(uint32_t account = 0; account < s_accounts.size(); ++account)
+      {
+        if(auto counters = accounts->find(account))
+        {
+          s_retired[account].made += counters->made.load(std::memory_order_relaxed);
+          s_retired[account].live += counters->live.load(std::memory_order_relaxed);
+          s_retired[account].bytes += counters->bytes.load(std::memory_order_relaxed);
+        }
+      }
+      std::erase(s_threads, accounts);
+      t_exited = true;
+    }
+  };
+
+  static void count(uint32_t account, int64_t made, int64_t live, int64_t bytes)
+  {
+    if(t_exited)
+    {
+      // an object destroyed by the destructor of another thread local
+      std::lock_guard lock(s_threads_mutex);
+      s_retired.resize(std::max<size_t>(s_retired.size(), account + 1));
+      s_retired[account].made += made;
+      s_retired[account].live += live;
+      s_retired[account].bytes += bytes;
+      return;
+    }
+
+    thread_local thread_owner owner;
+
+    auto& counters = owner.accounts->at(account);
+    detail::account_counters::add(counters.made, made);
+    detail::account_counters::add(counters.live, live);
+    detail::account_counters::add(counters.bytes, bytes);
+  }
+
+  // the deleter counting an object just made under key
+  static deleter made(size_t hash, const key_type& key, bool valid)
+  {
+    if(!valid)
+    {
+      return {};
+    }
+
+    auto d = deleter_of(hash, key);
+    count(d.account, 1, 1, int64_t(d.size));
+    return d;
+  }
+
+  //
+  // the deleter of the account of key, from the cache of the thread. the cached entries are
+  // dropped when the size of an account changes
+  //
+  static deleter deleter_of(size_t hash, const key_type& key)
+  {
+    struct cached_account
+    {
+      uint64_t version = 0; // of the accounts the entry was read from, 0 for an empty entry
+      size_t hash      = 0;
+      key_type key{};
+      deleter d;
+    };
+
+    thread_local std::array<cached_account, 64> cache;
+
+    auto& entry  = cache[hash % cache.size()];
+    auto version = s_version.load(std::memory_order_acquire);
+    if(entry.version == version && entry.hash == hash && entry.key == key)
+    {
+      return entry.d;
+    }
+
+    deleter d;
+    {
+      std::shared_lock lock(s_accounts_mutex);
+
+      if(auto account = find_account(hash, key); account != no_account)
+      {
+        d = {account, uint32_t(s_accounts[account].size)};
+      }
+    }
+    if(d.account == no_account)
+    {
+      d = account_of(hash, key, 0);
+    }
+
+    entry = {version, hash, key, d};
+    return d;
+  }
+
+  // the account of key, no_account if none. s_accounts_mutex must be held
+  static uint32_t find_account(size_t hash, const key_type& key)
+  {
+    auto it      = s_index.find(hash);
+    auto account = it != s_index.end() ? it->second : no_account;
+    while(account != no_account && !(s_accounts[account].key == key))
+    {
+      account = s_collisions[account];
+    }
+    return account;
+  }
+
+  //
+  // the account of key, created on its first registration or its first object. the size given
+  // by a registration replaces the previous one
+  //
+  static deleter account_of(size_t hash, const key_type& key, size_t size)
+  {
+    std::unique_lock lock(s_accounts_mutex);
+
+    auto account = find_account(hash, key);
+    if(account == no_account)
+    {
+      if(s_accounts.size() == detail::thread_accounts::block_size * detail::thread_accounts::block_count)
+      {
+        throw std::runtime_error("Too many accounted keys");
+      }
+
+      // the accounts of a hash are chained, the last one created first
+      account = uint32_t(s_accounts.size());
+      auto it = s_index.find(hash);
+      if(it != s_index.end())
+      {
+        s_collisions.push_back(it->second);
+        it->second = account;
+      }
+      else
+      {
+        s_collisions.push_back(no_account);
+        s_index.insert(hash, account);
+      }
+      s_accounts.push_back({key});
+    }
+
+    auto& entry = s_accounts[account];
+    if(size != 0 && size != entry.size)
+    {
+      entry.size = size;
+      s_version.fetch_add(1, std::memory_order_release);
+    }
+    return {account, uint32_t(entry.size)};
+  }
+
+  static inline std::atomic<bool> s_enabled = false;
+
+  static inline std::shared_mutex s_accounts_mutex;
+  static inline std::vector<key_account<key_type>> s_accounts; // the key and size of each account
+  static inline std::vector<uint32_t> s_collisions; // the next account of the same hash, per account
+  static inline typename Factory::policies_type::storage::template map<size_t, uint32_t> s_index; // the last account of a hash
+  static inline std::atomic<uint64_t> s_version = 1; // incremented when the size of an account changes
+
+  static inline std::mutex s_threads_mutex;
+  static inline std::vector<std::shared_ptr<detail::thread_accounts>> s_threads;
+  static inline std::vector<retired_counts> s_retired;
+  static inline thread_local bool t_exited = false;
+};
+
+#endif // STATIC_FACTORY_ACCOUNTING_H
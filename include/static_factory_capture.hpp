@@ -0,0 +1,588 @@
+#ifndef STATIC_FACTORY_CAPTURE_H
+#define STATIC_FACTORY_CAPTURE_H
+
+#include "static_factory.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <typeindex>
+#include <typeinfo>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+//
+// capture file format, native endianness:
+//
+//   capture_header                  magic and version
+//   capture_record...               the calls, in chunks of consecutive calls of one thread
+//   per signature:
+//     uint32_t name_size
+//     name_size bytes               typeid(RetType(*)(Args...)).name() of the signature
+//   capture_footer                  offset of the signature table and number of signatures
+//
+
+namespace detail
+{
+
+struct capture_header
+{
+  char magic[4] = {'S', 'F', 'W', 'C'};
+  uint32_t version = 1;
+};
+
+struct capture_record
+{
+  uint64_t hash;      // hash of the key, 0 for try_make*
+  uint64_t timestamp; // nanoseconds since the start of the capture
+  uint32_t thread;    // index of the calling thread, in the order the threads made their first call
+  uint32_t signature; // index in the signature table, with any_key_flag for try_make*
+};
+
+static_assert(sizeof(capture_record) == 24);
+
+inline constexpr uint32_t any_key_flag = 0x80000000u;
+
+struct capture_footer
+{
+  uint64_t signatures_offset;
+  uint32_t signature_count;
+  char magic[4] = {'S', 'F', 'W', 'C'};
+};
+
+} // namespace detail
+
+/**
+ * \brief The workload_capture class logs the make* and try_make* calls of the instrumented factories.
+ *
+ * The calls of the factories compiled with factory_policies::capture_instrumentation are logged
+ * between start() and stop() as fixed size records of the key hash, the signature, the thread and
+ * the timestamp. The records are buffered per thread and appended to the file in chunks, the
+ * signatures are written once, in a table at the end of the file.
+ * The capture is replayed with workload_replay.
+ */
+class workload_capture
+{
+  public:
+  static constexpr size_t buffer_records = 4096;
+
+  //
+  // start logging to path, truncated. throws std::runtime_error if a capture is already running
+  // or the file cannot be opened
+  //
+  static void start(const std::string& path)
+  {
+    std::lock_guard lock(s_mutex);
+
+    if(s_file)
+    {
+      throw std::runtime_error("Capture already started");
+    }
+
+    s_file = std::fopen(path.c_str(), "wb");
+    if(!s_file)
+    {
+      throw std::runtime_error("Cannot open capture file " + path);
+    }
+
+    detail::capture_header header;
+    std::fwrite(&header, sizeof(header), 1, s_file);
+
+    s_signatures.clear();
+    s_signature_names.clear();
+    s_thread_count = 0;
+    s_start        = std::chrono::steady_clock::now();
+    s_session.fetch_add(1, std::memory_order_relaxed);
+    s_active.store(true, std::memory_order_release);
+  }
+
+  //
+  // flush the calls of all the threads, write the signature table and close the file
+  // returns the number of calls logged
+  //
+  static size_t stop()
+  {
+    s_active.store(false, std::memory_order_release);
+
+    std::vector<std::shared_ptr<thread_buffer>> buffers;
+    {
+      std::lock_guard lock(s_mutex);
+      buffers = s_buffers;
+    }
+
+    // a buffer mutex is always locked before s_mutex
+    for(auto& buffer : buffers)
+    {
+      std::lock_guard buffer_lock(buffer->mutex);
+      std::lock_guard lock(s_mutex);
+      flush(*buffer);
+    }
+
+    std::lock_guard lock(s_mutex);
+
+    if(!s_file)
+    {
+      return 0;
+    }
+
+    detail::capture_footer footer{uint64_t(std::ftell(s_file)), uint32_t(s_signature_names.size())};
+    for(auto& name : s_signature_names)
+    {
+      auto size = uint32_t(name.size());
+      std::fwrite(&size, sizeof(size), 1, s_file);
+      std::fwrite(name.data(), 1, name.size(), s_file);
+    }
+    std::fwrite(&footer, sizeof(footer), 1, s_file);
+
+    std::fclose(s_file);
+    s_file = nullptr;
+
+    return std::exchange(s_record_count, 0);
+  }
+
+  static bool active()
+  {
+    return s_active.load(std::memory_order_acquire);
+  }
+
+  // log call, if a capture is running
+  static void record(const detail::make_call& call)
+  {
+    if(!active())
+    {
+      return;
+    }
+
+    auto now     = std::chrono::steady_clock::now();
+    auto& buffer = local_buffer();
+
+    std::lock_guard lock(buffer.mutex);
+
+    auto session = s_session.load(std::memory_order_relaxed);
+    if(buffer.session != session)
+    {
+      // first call of the thread in this capture
+      std::lock_guard global_lock(s_mutex);
+      buffer.records.clear();
+      buffer.signatures.clear();
+      buffer.session = session;
+      buffer.thread  = s_thread_count++;
+    }
+
+    auto [it, inserted] = buffer.signatures.try_emplace(std::type_index(call.signature), 0);
+    if(inserted)
+    {
+      it->second = signature_index(call.signature);
+    }
+
+    buffer.records.push_back({uint64_t(call.hash),
+      uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(now - s_start).count()),
+      buffer.thread,
+      it->second | (call.any_key ? detail::any_key_flag : 0)});
+
+    if(buffer.records.size() == buffer_records)
+    {
+      std::lock_guard global_lock(s_mutex);
+      flush(buffer);
+    }
+  }
+
+  private:
+  // the calls of a thread not written yet
+  struct thread_buffer
+  {
+    std::mutex mutex;
+    size_t session  = 0;
+    uint32_t thread = 0;
+    std::vector<detail::capture_record> records;
+    std::unordered_map<std::type_index, uint32_t> signatures;
+  };
+
+  // registers the buffer of the thread, written and released at the thread exit
+  struct thread_buffer_owner
+  {
+    std::shared_ptr<thread_buffer> buffer = std::make_shared<thread_buffer>();
+
+    thread_buffer_owner()
+    {
+      buffer->records.reserve(buffer_records);
+
+      std::lock_guard lock(s_mutex);
+      s_buffers.push_back(buffer);
+    }
+
+    ~thread_buffer_owner()
+    {
+      {
+        std::lock_guard buffer_lock(buffer->mutex);
+        std::lock_guard lock(s_mutex);
+        flush(*buffer);
+      }
+
+      std::lock_guard lock(s_mutex);
+      std::erase(s_buffers, buffer);
+    }
+  };
+
+  static thread_buffer& local_buffer()
+  {
+    thread_local thread_buffer_owner owner;
+    return *owner.buffer;
+  }
+
+  // append the records of the current capture to the file. s_mutex and the buffer mutex must be held
+  static void flush(thread_buffer& buffer)
+  {
+    if(s_file && buffer.session == s_session.load(std::memory_order_relaxed))
+    {
+      std::fwrite(buffer.records.data(), sizeof(detail::capture_record), buffer.records.size(), s_file);
+      s_record_count += buffer.records.size();
+    }
+    buffer.records.clear();
+  }
+
+  static uint32_t signature_index(const std::type_info& signature)
+  {
+    std::lock_guard lock(s_mutex);
+
+    auto [it, inserted] = s_signatures.try_emplace(std::type_index(signature), uint32_t(s_signature_names.size()));
+    if(inserted)
+    {
+      s_signature_names.emplace_back(signature.name());
+    }
+    return it->second;
+  }
+
+  static inline std::mutex s_mutex;
+  static inline std::FILE* s_file = nullptr;
+  static inline std::atomic<bool> s_active = false;
+  static inline std::atomic<size_t> s_session = 0;
+  static inline std::chrono::steady_clock::time_point s_start;
+  static inline uint32_t s_thread_count = 0;
+  static inline size_t s_record_count   = 0;
+  static inline std::vector<std::shared_ptr<thread_buffer>> s_buffers;
+  static inline std::unordered_map<std::type_index, uint32_t> s_signatures;
+  static inline std::vector<std::string> s_signature_names;
+};
+
+namespace factory_policies
+{
+
+// log the calls to workload_capture while a capture is running
+struct capture_instrumentation : no_instrumentation
+{
+  struct scope : no_instrumentation::scope
+  {
+    explicit scope(const detail::make_call& call) : no_instrumentation::scope{call}
+    {
+      workload_capture::record(call);
+    }
+  };
+};
+
+} // namespace factory_policies
+
+/**
+ * \brief The calls of a capture written by workload_capture.
+ */
+struct workload_log
+{
+  std::vector<std::string> signatures;
+  std::vector<detail::capture_record> records;
+
+  //
+  // read the capture at path, throws std::runtime_error if it is not a complete capture
+  //
+  static workload_log load(const std::string& path)
+  {
+    std::unique_ptr<std::FILE, int (*)(std::FILE*)> file(std::fopen(path.c_str(), "rb"), &std::fclose);
+    if(!file)
+    {
+      throw std::runtime_error("Cannot open capture file " + path);
+    }
+
+    detail::capture_header header;
+    detail::capture_footer footer;
+    if(std::fread(&header, sizeof(header), 1, file.get()) != 1 ||
+      std::memcmp(header.magic, detail::capture_header().magic, sizeof(header.magic)) != 0 ||
+      header.version != detail::capture_header().version || std::fseek(file.get(), -long(sizeof(footer)), SEEK_END) != 0 ||
+      std::fread(&footer, sizeof(footer), 1, file.get()) != 1 ||
+      std::memcmp(footer.magic, header.magic, sizeof(footer.magic)) != 0)
+    {
+      throw std::runtime_error(path + ": invalid or incomplete capture");
+    }
+
+    // the sizes read from the file are checked against it before anything is allocated: the
+    // records end at the signature table, which ends at the footer
+    auto file_size = std::ftell(file.get());
+    if(file_size < 0)
+    {
+      throw std::runtime_error(path + ": invalid or incomplete capture");
+    }
+
+    uint64_t table_end = uint64_t(file_size) - sizeof(footer);
+    if(footer.signatures_offset < sizeof(header) || footer.signatures_offset > table_end ||
+      (footer.signatures_offset - sizeof(header)) % sizeof(detail::capture_record) != 0 ||
+      footer.signature_count > (table_end - footer.signatures_offset) / sizeof(uint32_t))
+    {
+      throw std::runtime_error(path + ": invalid or incomplete capture");
+    }
+
+    workload_log log;
+    log.records.resize((footer.signatures_offset - sizeof(header)) / sizeof(detail::capture_record));
+    log.signatures.resize(footer.signature_count);
+
+    bool valid = std::fseek(file.get(), long(sizeof(header)), SEEK_SET) == 0 &&
+      std::fread(log.records.data(), sizeof(detail::capture_record), log.records.size(), file.get()) ==
+        log.records.size();
+
+    uint64_t remaining = table_end - footer.signatures_offset;
+    for(auto& name : log.signatures)
+    {
+      uint32_t size = 0;
+      valid = valid && remaining >= sizeof(size) && std::fread(&size, sizeof(size), 1, file.get()) == 1 &&
+        size <= remaining - sizeof(size);
+      name.resize(valid ? size : 0);
+      valid = valid && std::fread(name.data(), 1, name.size(), file.get()) == name.size();
+      remaining -= valid ? sizeof(size) + size : 0;
+    }
+
+    if(!valid)
+    {
+      throw std::runtime_error(path + ": truncated capture");
+    }
+
+    return log;
+  }
+};
+
+/**
+ * \brief The workload_replay class re-drives a captured workload against a factory.
+ *
+ * The calls of each captured thread are replayed in order on a thread of their own, at full speed
+ * or at the pacing of the capture. The arguments are not captured: the argument values of each
+ * signature are given to bind(), the calls of the signatures not bound are skipped.
+ * The keys are replayed by hash, so the factory must use the hash policy of the captured one,
+ * its other policies are free.
+ *
+ * e.g:
+ *  workload_replay<static_factory<Pet, std::string, hashed_policies>> replay(workload_log::load("pets.cap"));
+ *  replay.bind<std::unique_ptr<Pet>>();
+ *  replay.bind<std::shared_ptr<Pet>, std::string>("Rex");
+ *  auto report = replay.run({.original_pacing = true});
+ *
+ * \tparam Factory The static_factory the calls are made on.
+ */
+template <typename Factory>
+class workload_replay
+{
+  public:
+  using factory   = Factory;
+  using base_type = typename Factory::base_type;
+
+  struct options
+  {
+    bool original_pacing = false; // wait for the captured timestamps, instead of replaying at full speed
+  };
+
+  struct report
+  {
+    size_t calls   = 0; // calls replayed
+    size_t failed  = 0; // calls that threw or returned nullptr
+    size_t skipped = 0; // calls of the signatures not bound
+    double seconds = 0;
+    double calls_per_second = 0;
+
+    // latency of the calls in nanoseconds
+    uint64_t p50  = 0;
+    uint64_t p90  = 0;
+    uint64_t p99  = 0;
+    uint64_t p999 = 0;
+    uint64_t max  = 0;
+  };
+
+  explicit workload_replay(workload_log log) : m_log{std::move(log)}, m_invokers(m_log.signatures.size())
+  {
+  }
+
+  //
+  // replay the calls of the signature RetType(Args...) with values, RetType being base_type or a
+  // raw, shared or unique pointer of base_type. the calls of any signature can be bound, even if
+  // it is not in the capture
+  //
+  template <typename RetType, typename... Args>
+  void bind(Args... values)
+  {
+    auto name = std::string(detail::signature_info<RetType, Args...>().name());
+    auto it   = std::find(m_log.signatures.begin(), m_log.signatures.end(), name);
+    if(it == m_log.signatures.end())
+    {
+      return;
+    }
+
+    m_invokers[size_t(it - m_log.signatures.begin())] = [args = std::make_tuple(std::move(values)...)](
+                                                          uint64_t hash, bool any_key, bool& failed)
+    {
+      return std::apply(
+        [&](const auto&... arg)
+        {
+          return invoke<RetType>(hash, any_key, failed, arg...);
+        },
+        args);
+    };
+  }
+
+  //
+  // replay all the calls and report the throughput and the latencies
+  //
+  report run(options opts = {}) const
+  {
+    // the calls of each captured thread, in order
+    std::vector<std::vector<const detail::capture_record*>> threads;
+    for(auto& record : m_log.records)
+    {
+      if(threads.size() <= record.thread)
+      {
+        threads.resize(record.thread + 1);
+      }
+      threads[record.thread].push_back(&record);
+    }
+
+    struct thread_result
+    {
+      std::vector<uint64_t> latencies;
+      size_t failed  = 0;
+      size_t skipped = 0;
+    };
+    std::vector<thread_result> results(threads.size());
+
+    auto start = std::chrono::steady_clock::now();
+    {
+      std::vector<std::jthread> workers;
+      for(size_t t = 0; t < threads.size(); ++t)
+      {
+        workers.emplace_back(
+          [&, t]
+          {
+            auto& result = results[t];
+            result.latencies.reserve(threads[t].size());
+
+            for(auto record : threads[t])
+            {
+              auto& invoker = m_invokers[record->signature & ~detail::any_key_flag];
+              if(!invoker)
+              {
+                ++result.skipped;
+                continue;
+              }
+
+              if(opts.original_pacing)
+              {
+                std::this_thread::sleep_until(start + std::chrono::nanoseconds(record->timestamp));
+              }
+
+              bool failed = false;
+              result.latencies.push_back(invoker(record->hash, record->signature & detail::any_key_flag, failed));
+              result.failed += failed;
+            }
+          });
+      }
+    }
+    auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    report summary;
+    std::vector<uint64_t> latencies;
+    for(auto& result : results)
+    {
+      latencies.insert(latencies.end(), result.latencies.begin(), result.latencies.end());
+      summary.failed += result.failed;
+      summary.skipped += result.skipped;
+    }
+    std::sort(latencies.begin(), latencies.end());
+
+    auto percentile = [&latencies](double p)
+    {
+      return latencies.empty() ? 0 : latencies[std::min(latencies.size() - 1, size_t(p * double(latencies.size())))];
+    };
+
+    summary.calls            = latencies.size();
+    summary.seconds          = seconds;
+    summary.calls_per_second = seconds > 0 ? double(summary.calls) / seconds : 0;
+    summary.p50              = percentile(0.5);
+    summary.p90              = percentile(0.9);
+    summary.p99              = percentile(0.99);
+    summary.p999             = percentile(0.999);
+    summary.max              = latencies.empty() ? 0 : latencies.back();
+    return summary;
+  }
+
+  private:
+  using invoker_type = std::function<uint64_t(uint64_t hash, bool any_key, bool& failed)>;
+
+  // make the object, return the latency of the call. the object is destroyed after the measure
+  template <typename RetType, typename... Args>
+  static uint64_t invoke(uint64_t hash, bool any_key, bool& failed, const Args&... args)
+  {
+    auto key   = typename factory::prepared_key{size_t(hash)};
+    auto start = std::chrono::steady_clock::now();
+    try
+    {
+      RetType object = make<RetType>(key, any_key, args...);
+      auto latency   = std::chrono::steady_clock::now() - start;
+
+      if constexpr(std::is_pointer_v<RetType>)
+      {
+        failed = object == nullptr;
+        delete object;
+      }
+      else if constexpr(!std::is_same_v<RetType, base_type>)
+      {
+        failed = object == nullptr;
+      }
+      return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count());
+    }
+    catch(...)
+    {
+      failed = true;
+      return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    }
+  }
+
+  template <typename RetType, typename... Args>
+  static RetType make(typename factory::prepared_key key, bool any_key, const Args&... args)
+  {
+    if constexpr(std::is_same_v<RetType, base_type>)
+    {
+      return any_key ? factory::try_make(args...) : factory::make(key, args...);
+    }
+    else if constexpr(std::is_pointer_v<RetType>)
+    {
+      return any_key ? factory::try_make_ptr(args...) : factory::make_ptr(key, args...);
+    }
+    else if constexpr(detail::is_specialization_of_v<RetType, std::shared_ptr>)
+    {
+      return any_key ? factory::try_make_shared(args...) : factory::make_shared(key, args...);
+    }
+    else
+    {
+      return any_key ? factory::try_make_unique(args...) : factory::make_unique(key, args...);
+    }
+  }
+
+  workload_log m_log;
+  std::vector<invoker_type> m_invokers;
+};
+
+#endif // STATIC_FACTORY_CAPTURE_H
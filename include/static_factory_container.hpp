@@ -0,0 +1,353 @@
+#ifndef STATIC_FACTORY_CONTAINER_H
+#define STATIC_FACTORY_CONTAINER_H
+
+#include "static_factory.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * \brief The dependencies of a service, given to its constructor in the declared order.
+ *
+ * \tparam BaseType The base type of the services.
+ * \tparam KeyType The key type of the services.
+ */
+template <typename BaseType, typename KeyType>
+class service_dependencies
+{
+  public:
+  service_dependencies(std::span<const KeyType> keys, std::vector<std::shared_ptr<BaseType>> services)
+    : m_keys{keys},
+      m_services{std::move(services)}
+  {
+  }
+
+  size_t size() const
+  {
+    return m_services.size();
+  }
+
+  const std::shared_ptr<BaseType>& get(size_t index) const
+  {
+    return m_services.at(index);
+  }
+
+  //
+  // the dependency at index cast to T, nullptr if it is not a T
+  //
+  template <typename T>
+  std::shared_ptr<T> get(size_t index) const
+  {
+    return std::dynamic_pointer_cast<T>(get(index));
+  }
+
+  //
+  // the dependency declared with key, throws std::runtime_error if it was not declared
+  //
+  template <typename T = BaseType>
+  std::shared_ptr<T> get(const KeyType& key) const
+  {
+    auto it = std::find(m_keys.begin(), m_keys.end(), key);
+    if(it == m_keys.end())
+    {
+      throw std::runtime_error("Undeclared dependency");
+    }
+    return std::dynamic_pointer_cast<T>(m_services[size_t(it - m_keys.begin())]);
+  }
+
+  private:
+  std::span<const KeyType> m_keys;
+  std::vector<std::shared_ptr<BaseType>> m_services;
+};
+
+/**
+ * \brief The service_container class creates singletons of registered types with their dependencies.
+ *
+ * A service is a type of the factory registered with the keys of the services it depends on.
+ * It is made once with make_shared, from the service_dependencies holding its dependencies,
+ * the first time it is resolved. Resolving is thread safe, and build_all() makes all the
+ * services level by level of the dependency graph, the services of a level in parallel.
+ * A service is registered once and lives as long as the container.
+ *
+ * e.g:
+ *  service_container<static_factory<Service>> services;
+ *  services.register_service<Database>("database", {"config", "logger"});
+ *  auto db = services.resolve<Database>("database");
+ *
+ * \tparam Factory The static_factory the services are registered in.
+ */
+template <typename Factory>
+class service_container
+{
+  public:
+  using factory      = Factory;
+  using base_type    = typename Factory::base_type;
+  using key_type     = typename Factory::key_type;
+  using dependencies = service_dependencies<base_type, key_type>;
+
+  service_container() = default;
+
+  service_container(const service_container&)            = delete;
+  service_container& operator=(const service_container&) = delete;
+
+  //
+  // register ConcreteType, constructible from const dependencies&, as the service key
+  // depending on the services dependency_keys
+  // throws std::runtime_error if the service key is already registered in the container
+  //
+  template <typename ConcreteType>
+  void register_service(const key_type& key, std::vector<key_type> dependency_keys = {})
+  {
+    add_service(key, std::move(dependency_keys));
+    factory::template register_type<ConcreteType, const dependencies&>(key);
+  }
+
+  //
+  // declare the dependencies of the service key, whose type is already registered in the
+  // factory for const dependencies&, e.g. with STATIC_FACTORY_REGISTER
+  // throws std::runtime_error if the service key is already registered in the container: the
+  // services are never replaced, as they may be in use by resolve() and build_all()
+  //
+  void add_service(const key_type& key, std::vector<key_type> dependency_keys = {})
+  {
+    std::unique_lock lock(m_mutex);
+
+    auto [it, inserted] = m_services.try_emplace(key);
+    if(!inserted)
+    {
+      throw std::runtime_error("Service already registered");
+    }
+    it->second               = std::make_unique<service>();
+    it->second->key          = factory::prepare(key);
+    it->second->dependencies = std::move(dependency_keys);
+  }
+
+  //
+  // the singleton of the service key, made with its dependencies on first use
+  // throws std::runtime_error if the service or one of its dependencies is not registered,
+  // or if the dependencies form a cycle
+  //
+  std::shared_ptr<base_type> resolve(const key_type& key)
+  {
+    auto& entry = find(key);
+
+    if(!entry.ready.load(std::memory_order_acquire))
+    {
+      check_acyclic(key);
+      create(entry);
+    }
+    return entry.instance;
+  }
+
+  template <typename T>
+  std::shared_ptr<T> resolve(const key_type& key)
+  {
+    return std::dynamic_pointer_cast<T>(resolve(key));
+  }
+
+  //
+  // make all the services not made yet, level by level of the dependency graph: the services
+  // of a level only depend on the previous levels and are made in parallel on threads threads
+  //
+  void build_all(size_t threads = std::max(1u, std::thread::hardware_concurrency()))
+  {
+    for(auto& level : levels())
+    {
+      std::atomic<size_t> next = 0;
+      std::exception_ptr error;
+      std::mutex error_mutex;
+
+      auto worker = [&]
+      {
+        for(size_t i; (i = next.fetch_add(1)) < level.size();)
+        {
+          try
+          {
+            create(*level[i]);
+          }
+          catch(...)
+          {
+            std::lock_guard lock(error_mutex);
+            error = error ? error : std::current_exception();
+          }
+        }
+      };
+
+      std::vector<std::thread> workers;
+      for(size_t i = 1; i < std::min(threads, level.size()); ++i)
+      {
+        workers.emplace_back(worker);
+      }
+      worker();
+      for(auto& w : workers)
+      {
+        w.join();
+      }
+
+      if(error)
+      {
+        std::rethrow_exception(error);
+      }
+    }
+  }
+
+  private:
+  struct service
+  {
+    typename factory::prepared_key key;
+    std::vector<key_type> dependencies;
+
+    std::once_flag once;
+    std::atomic<bool> ready = false;
+    std::shared_ptr<base_type> instance;
+  };
+
+  service& find(const key_type& key)
+  {
+    std::shared_lock lock(m_mutex);
+
+    auto it = m_services.find(key);
+    if(it == m_services.end() || !it->second)
+    {
+      throw std::runtime_error("Service not registered");
+    }
+    return *it->second;
+  }
+
+  // make the service once, after its dependencies. the dependency graph must be acyclic
+  void create(service& entry)
+  {
+    std::call_once(entry.once,
+      [&]
+      {
+        std::vector<std::shared_ptr<base_type>> resolved;
+        resolved.reserve(entry.dependencies.size());
+        for(auto& dependency : entry.dependencies)
+        {
+          auto& dependency_entry = find(dependency);
+          create(dependency_entry);
+          resolved.push_back(dependency_entry.instance);
+        }
+
+        entry.instance = factory::make_shared(entry.key, dependencies(entry.dependencies, std::move(resolved)));
+        entry.ready.store(true, std::memory_order_release);
+      });
+  }
+
+  // throws std::runtime_error if a cycle is reachable from key, or a dependency is not registered
+  void check_acyclic(const key_type& key)
+  {
+    std::shared_lock lock(m_mutex);
+
+    enum class state
+    {
+      visiting,
+      done
+    };
+    std::unordered_map<const service*, state> states;
+
+    std::function<void(const key_type&)> visit = [&](const key_type& k)
+    {
+      auto it = m_services.find(k);
+      if(it == m_services.end() || !it->second)
+      {
+        throw std::runtime_error("Service not registered");
+      }
+
+      auto entry         = it->second.get();
+      auto [s, inserted] = states.try_emplace(entry, state::visiting);
+      if(!inserted)
+      {
+        if(s->second == state::visiting)
+        {
+          throw std::runtime_error("Dependency cycle");
+        }
+        return;
+      }
+
+      if(!entry->ready.load(std::memory_order_acquire))
+      {
+        for(auto& dependency : entry->dependencies)
+        {
+          visit(dependency);
+        }
+      }
+      states[entry] = state::done;
+    };
+
+    visit(key);
+  }
+
+  // the services not made yet grouped by level: a service is one level above its highest dependency
+  std::vector<std::vector<service*>> levels()
+  {
+    std::shared_lock lock(m_mutex);
+
+    std::unordered_map<const service*, size_t> level_of;
+    std::unordered_map<const service*, bool> visiting;
+    std::vector<std::vector<service*>> result;
+
+    std::function<size_t(service&)> visit = [&](service& entry) -> size_t
+    {
+      if(auto it = level_of.find(&entry); it != level_of.end())
+      {
+        return it->second;
+      }
+      if(visiting[&entry])
+      {
+        throw std::runtime_error("Dependency cycle");
+      }
+      visiting[&entry] = true;
+
+      size_t level = 0;
+      if(!entry.ready.load(std::memory_order_acquire))
+      {
+        for(auto& dependency : entry.dependencies)
+        {
+          auto it = m_services.find(dependency);
+          if(it == m_services.end() || !it->second)
+          {
+            throw std::runtime_error("Service not registered");
+          }
+          level = std::max(level, visit(*it->second) + 1);
+        }
+
+        if(result.size() <= level)
+        {
+          result.resize(level + 1);
+        }
+        result[level].push_back(&entry);
+      }
+
+      visiting[&entry] = false;
+      level_of[&entry] = level;
+      return level;
+    };
+
+    for(auto& [_, entry] : m_services)
+    {
+      if(entry)
+      {
+        visit(*entry);
+      }
+    }
+
+    return result;
+  }
+
+  std::shared_mutex m_mutex;
+  std::unordered_map<key_type, std::unique_ptr<service>> m_services;
+};
+
+#endif // STATIC_FACTORY_CONTAINER_H
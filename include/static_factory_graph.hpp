@@ -0,0 +1,513 @@
+#ifndef STATIC_FACTORY_GRAPH_H
+#define STATIC_FACTORY_GRAPH_H
+
+#include "static_factory.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//
+// config format of an object graph, a list of root nodes:
+//
+//   # comment until the end of the line
+//   key(arg, "quoted arg", ...) { child child ... }
+//
+// the arguments and the children are optional: `key`, `key()` and `key {}` are the same node.
+// a key or an unquoted argument is a sequence of characters other than spaces, ',', '"', '#',
+// '(', ')', '{' and '}'. a quoted argument has no escape sequence.
+//
+
+/**
+ * \brief A node of an object graph, given to the constructor of its type.
+ *
+ * \tparam Pointer The pointer owning the children, std::unique_ptr or std::shared_ptr of the base type.
+ */
+template <typename Pointer>
+struct graph_node
+{
+  graph_node(std::span<const std::string_view> a, std::vector<Pointer> c) : args{a}, children{std::move(c)}
+  {
+  }
+
+  // move only: the children are handed over to the constructed object
+  graph_node(graph_node&&)                 = default;
+  graph_node& operator=(graph_node&&)      = default;
+  graph_node(const graph_node&)            = delete;
+  graph_node& operator=(const graph_node&) = delete;
+
+  std::span<const std::string_view> args; // views into the config, valid as long as the graph source
+  std::vector<Pointer> children;
+};
+
+namespace detail
+{
+
+// nodes of a config in preorder: the descendants of a node follow it
+class graph_config
+{
+  public:
+  struct node
+  {
+    std::string_view key;
+    uint32_t first_arg;
+    uint32_t arg_count;
+    uint32_t first_child; // index in children()
+    uint32_t child_count;
+    uint32_t size;        // number of nodes of the subtree
+  };
+
+  explicit graph_config(std::string_view text) : m_text{text}
+  {
+    parse();
+  }
+
+  std::span<const node> nodes() const
+  {
+    return m_nodes;
+  }
+
+  std::span<const std::string_view> args(const node& n) const
+  {
+    return std::span(m_args).subspan(n.first_arg, n.arg_count);
+  }
+
+  std::span<const uint32_t> children(const node& n) const
+  {
+    return std::span(m_children).subspan(n.first_child, n.child_count);
+  }
+
+  std::span<const uint32_t> roots() const
+  {
+    return m_roots;
+  }
+
+  private:
+  static bool is_separator(char c)
+  {
+    return std::string_view(" \t\r\n,\"#(){}").find(c) != std::string_view::npos;
+  }
+
+  void skip_blanks()
+  {
+    while(m_position < m_text.size())
+    {
+      auto c = m_text[m_position];
+      if(c == '#')
+      {
+        auto end   = m_text.find('\n', m_position);
+        m_position = end == std::string_view::npos ? m_text.size() : end;
+      }
+      else if(c == ' ' || c == '\t' || c == '\r' || c == '\n')
+      {
+        ++m_position;
+      }
+      else
+      {
+        break;
+      }
+    }
+  }
+
+  bool consume(char c)
+  {
+    skip_blanks();
+    if(m_position < m_text.size() && m_text[m_position] == c)
+    {
+      ++m_position;
+      return true;
+    }
+    return false;
+  }
+
+  std::string_view token()
+  {
+    skip_blanks();
+
+    if(m_position < m_text.size() && m_text[m_position] == '"')
+    {
+      auto end = m_text.find('"', m_position + 1);
+      if(end == std::string_view::npos)
+      {
+        error("unterminated string");
+      }
+      auto value = m_text.substr(m_position + 1, end - m_position - 1);
+      m_position = end + 1;
+      return value;
+    }
+
+    auto begin = m_position;
+    while(m_position < m_text.size() && !is_separator(m_text[m_position]))
+    {
+      ++m_position;
+    }
+    if(begin == m_position)
+    {
+      error("expected a key or an argument");
+    }
+    return m_text.substr(begin, m_position - begin);
+  }
+
+  [[noreturn]] void error(const std::string& message) const
+  {
+    auto line = std::count(m_text.begin(), m_text.begin() + std::ptrdiff_t(m_position), '\n') + 1;
+    throw std::runtime_error("line " + std::to_string(line) + ": " + message);
+  }
+
+  // iterative, so that the depth of the graph is not limited by the stack
+  void parse()
+  {
+    // the open nodes, with the children parsed so far
+    struct open_node
+    {
+      uint32_t index;
+      std::vector<uint32_t> children;
+    };
+    std::vector<open_node> open;
+
+    for(;;)
+    {
+      skip_blanks();
+
+      if(m_position == m_text.size())
+      {
+        if(!open.empty())
+        {
+          error("missing '}'");
+        }
+        return;
+      }
+
+      if(consume('}'))
+      {
+        if(open.empty())
+        {
+          error("unexpected '}'");
+        }
+        close_node(open.back().index, open.back().children);
+        open.pop_back();
+        continue;
+      }
+
+      auto index = uint32_t(m_nodes.size());
+      node n{token(), uint32_t(m_args.size()), 0, 0, 0, 0};
+
+      if(consume('('))
+      {
+        if(!consume(')'))
+        {
+          do
+          {
+            m_args.push_back(token());
+          } while(consume(','));
+
+          if(!consume(')'))
+          {
+            error("expected ')'");
+          }
+        }
+      }
+      n.arg_count = uint32_t(m_args.size()) - n.first_arg;
+      m_nodes.push_back(n);
+
+      (open.empty() ? m_roots : open.back().children).push_back(index);
+
+      if(consume('{'))
+      {
+        open.push_back({index, {}});
+      }
+      else
+      {
+        close_node(index, {});
+      }
+    }
+  }
+
+  void close_node(uint32_t index, const std::vector<uint32_t>& children)
+  {
+    auto& n       = m_nodes[index];
+    n.first_child = uint32_t(m_children.size());
+    n.child_count = uint32_t(children.size());
+    n.size        = uint32_t(m_nodes.size()) - index;
+    m_children.insert(m_children.end(), children.begin(), children.end());
+  }
+
+  std::string_view m_text;
+  size_t m_position = 0;
+
+  std::vector<node> m_nodes;
+  std::vector<std::string_view> m_args;
+  std::vector<uint32_t> m_children;
+  std::vector<uint32_t> m_roots;
+};
+
+} // namespace detail
+
+/**
+ * \brief The graph_loader class builds the object graph described by a config file.
+ *
+ * The config is mapped and parsed without copy, the keys are views into the file and every
+ * distinct key is hashed once, each node still looks its function up under the factory lock.
+ * The objects are made bottom up with make_unique or make_shared from a graph_node holding their
+ * arguments and their children, so the registered types must be constructible from a graph_node:
+ * register_type<Filter, graph_node<std::unique_ptr<Node>>>("filter").
+ * The large independent subtrees of a graph of at least min_parallel_nodes nodes per thread are
+ * built in parallel. It pays off when the constructors cost more than the lookups, which all
+ * take the lock of the factory: for trivial nodes, the parallel build can be slower.
+ *
+ * \tparam Factory The static_factory the node types are registered in.
+ */
+template <typename Factory>
+class graph_loader
+{
+  public:
+  using factory   = Factory;
+  using base_type = typename Factory::base_type;
+  using key_type  = typename Factory::key_type;
+
+  static_assert(std::is_constructible_v<key_type, std::string_view>,
+    "The key type must be constructible from a std::string_view");
+
+  struct options
+  {
+    size_t threads            = std::max(1u, std::thread::hardware_concurrency());
+    size_t min_parallel_nodes = 1024; // per subtree built apart, and per thread for a parallel build
+  };
+
+  template <typename Pointer>
+  struct graph
+  {
+    std::shared_ptr<const void> source; // the mapped config and the arguments of the nodes
+    std::vector<Pointer> roots;
+  };
+
+  static graph<std::unique_ptr<base_type>> load_unique(const std::string& path, const options& opts = {})
+  {
+    return load<std::unique_ptr<base_type>>(path, opts);
+  }
+
+  static graph<std::shared_ptr<base_type>> load_shared(const std::string& path, const options& opts = {})
+  {
+    return load<std::shared_ptr<base_type>>(path, opts);
+  }
+
+  private:
+  struct source
+  {
+    void* address = nullptr;
+    size_t size   = 0;
+    std::unique_ptr<detail::graph_config> config;
+
+    source() = default;
+
+    source(const source&)            = delete;
+    source& operator=(const source&) = delete;
+
+    ~source()
+    {
+      if(address)
+      {
+        ::munmap(address, size);
+      }
+    }
+  };
+
+  static std::shared_ptr<source> map(const std::string& path)
+  {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0)
+    {
+      throw std::system_error(errno, std::generic_category(), path);
+    }
+
+    auto result = std::make_shared<source>();
+
+    struct stat status;
+    if(::fstat(fd, &status) == 0 && status.st_size > 0)
+    {
+      result->size    = size_t(status.st_size);
+      result->address = ::mmap(nullptr, result->size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if(result->address == MAP_FAILED)
+      {
+        result->address = nullptr;
+        auto error      = errno;
+        ::close(fd);
+        throw std::system_error(error, std::generic_category(), path);
+      }
+    }
+    ::close(fd);
+
+    return result;
+  }
+
+  template <typename Pointer>
+  static graph<Pointer> load(const std::string& path, const options& opts)
+  {
+    auto src = map(path);
+    src->config =
+      std::make_unique<detail::graph_config>(std::string_view(static_cast<const char*>(src->address), src->size));
+
+    auto& config = *src->config;
+    auto nodes   = config.nodes();
+
+    // every distinct key is hashed once
+    std::vector<typename factory::prepared_key> keys(nodes.size());
+    {
+      std::unordered_map<std::string_view, typename factory::prepared_key> resolved;
+      for(size_t i = 0; i < nodes.size(); ++i)
+      {
+        auto [it, inserted] = resolved.try_emplace(nodes[i].key);
+        if(inserted)
+        {
+          it->second = factory::prepare(key_type(nodes[i].key));
+        }
+        keys[i] = it->second;
+      }
+    }
+
+    std::vector<Pointer> built(nodes.size());
+
+    auto build = [&](uint32_t index)
+    {
+      auto& n = nodes[index];
+
+      graph_node<Pointer> node{config.args(n), {}};
+      node.children.reserve(n.child_count);
+      for(auto child : config.children(n))
+      {
+        node.children.push_back(std::move(built[child]));
+      }
+
+      if constexpr(detail::is_specialization_of_v<Pointer, std::shared_ptr>)
+      {
+        built[index] = factory::make_shared(keys[index], std::move(node));
+      }
+      else
+      {
+        built[index] = factory::make_unique(keys[index], std::move(node));
+      }
+    };
+
+    // the subtrees built in parallel, and the nodes above them built afterwards. a subtree is
+    // a range of the preorder, built in reverse order so that the children come first
+    std::vector<std::pair<uint32_t, uint32_t>> subtrees;
+    std::vector<uint32_t> above;
+    auto threads   = nodes.size() < opts.threads * opts.min_parallel_nodes ? size_t(1) : opts.threads;
+    auto max_nodes = std::max<size_t>(opts.min_parallel_nodes, nodes.size() / (threads * 4));
+    split(config, config.roots(), max_nodes, subtrees, above);
+
+    auto build_subtree = [&](std::pair<uint32_t, uint32_t> range)
+    {
+      for(auto index = range.second; index-- > range.first;)
+      {
+        build(index);
+      }
+    };
+
+    if(threads <= 1 || subtrees.size() <= 1)
+    {
+      std::for_each(subtrees.begin(), subtrees.end(), build_subtree);
+    }
+    else
+    {
+      std::atomic<size_t> next = 0;
+      std::exception_ptr error;
+      std::mutex error_mutex;
+
+      auto worker = [&]
+      {
+        for(size_t i; (i = next.fetch_add(1)) < subtrees.size();)
+        {
+          try
+          {
+            build_subtree(subtrees[i]);
+          }
+          catch(...)
+          {
+            std::lock_guard lock(error_mutex);
+            error = error ? error : std::current_exception();
+            next  = subtrees.size();
+          }
+        }
+      };
+
+      std::vector<std::thread> workers;
+      for(size_t i = 1; i < std::min(threads, subtrees.size()); ++i)
+      {
+        workers.emplace_back(worker);
+      }
+      worker();
+      for(auto& w : workers)
+      {
+        w.join();
+      }
+
+      if(error)
+      {
+        std::rethrow_exception(error);
+      }
+    }
+
+    // in preorder, so reversed the children come first
+    std::for_each(above.rbegin(), above.rend(), build);
+
+    graph<Pointer> result;
+    result.roots.reserve(config.roots().size());
+    for(auto root : config.roots())
+    {
+      result.roots.push_back(std::move(built[root]));
+    }
+    result.source = std::move(src);
+
+    return result;
+  }
+
+  // split the nodes into subtrees of at most max_nodes nodes and the nodes above them, in preorder
+  static void split(const detail::graph_config& config,
+    std::span<const uint32_t> roots,
+    size_t max_nodes,
+    std::vector<std::pair<uint32_t, uint32_t>>& subtrees,
+    std::vector<uint32_t>& above)
+  {
+    auto nodes = config.nodes();
+
+    std::vector<uint32_t> pending(roots.rbegin(), roots.rend());
+    while(!pending.empty())
+    {
+      auto index = pending.back();
+      pending.pop_back();
+
+      auto& n = nodes[index];
+      if(n.size <= max_nodes || n.child_count == 0)
+      {
+        subtrees.emplace_back(index, index + n.size);
+      }
+      else
+      {
+        above.push_back(index);
+        auto children = config.children(n);
+        pending.insert(pending.end(), children.rbegin(), children.rend());
+      }
+    }
+  }
+};
+
+#endif // STATIC_FACTORY_GRAPH_H
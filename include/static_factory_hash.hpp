@@ -0,0 +1,25 @@
+#ifndef STATIC_FACTORY_HASH_H
+#define STATIC_FACTORY_HASH_H
+
+#include <cstdint>
+#include <string_view>
+
+namespace detail
+{
+
+// seeded FNV-1a, shared by static_factory_generator and the generated perfect hash tables.
+// kept apart so that the generator does not include the factory
+constexpr uint64_t fnv1a(std::string_view str, uint64_t seed)
+{
+  uint64_t hash = 14695981039346656037ull ^ (seed * 0x9e3779b97f4a7c15ull);
+  for(char c : str)
+  {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 1099511628211ull;
+  }
+  return hash ^ (hash >> 32);
+}
+
+} // namespace detail
+
+#endif // STATIC_FACTORY_HASH_H
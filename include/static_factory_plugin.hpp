@@ -0,0 +1,283 @@
+#ifndef STATIC_FACTORY_PLUGIN_H
+#define STATIC_FACTORY_PLUGIN_H
+
+#include "static_factory.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <dlfcn.h>
+
+//
+// plugin side: a plugin is a shared object exporting a static_factory_plugin table that lists,
+// per key, the name of an extern "C" function creating the object. The functions are resolved
+// only when the key is first used.
+//
+
+extern "C"
+{
+  struct static_factory_plugin_entry
+  {
+    const char* interface; // name of the base type the entry is registered for
+    const char* key;
+    const char* create;    // symbol of a `void* create()` function returning a new base type
+  };
+
+  struct static_factory_plugin_table
+  {
+    uint32_t version;
+    uint32_t count;
+    const static_factory_plugin_entry* entries;
+  };
+}
+
+#define STATIC_FACTORY_PLUGIN_VERSION 1u
+#define STATIC_FACTORY_PLUGIN_TABLE_SYMBOL "static_factory_plugin"
+
+//
+// define the create function `symbol` returning a new ConcreteType as a Base*
+// e.g: STATIC_FACTORY_PLUGIN_CREATE(Pet, Dog, create_dog)
+//
+#define STATIC_FACTORY_PLUGIN_CREATE(Base, ConcreteType, symbol) \
+  extern "C" __attribute__((visibility("default"))) void* symbol() \
+  { \
+    return static_cast<Base*>(new ConcreteType()); \
+  }
+
+//
+// export the plugin table, followed by the entries
+// e.g: STATIC_FACTORY_PLUGIN_TABLE({"Pet", "Dog", "create_dog"}, {"Pet", "Cat", "create_cat"});
+//
+#define STATIC_FACTORY_PLUGIN_TABLE(...) \
+  static const static_factory_plugin_entry g_static_factory_plugin_entries[] = {__VA_ARGS__}; \
+  extern "C" __attribute__((visibility("default"))) const static_factory_plugin_table \
+    static_factory_plugin = {STATIC_FACTORY_PLUGIN_VERSION, \
+      sizeof(g_static_factory_plugin_entries) / sizeof(static_factory_plugin_entry), \
+      g_static_factory_plugin_entries}
+
+/**
+ * \brief The plugin_loader class registers the types exported by plugins in a static_factory.
+ *
+ * load() opens a plugin and registers all its entries for the interface in one batch, without
+ * resolving the create functions: a create function is looked up on the first make of its key.
+ * A plugin whose keys are already registered is rejected. unload() unregisters the functions of
+ * a plugin at once, keeping the ones registered over its keys after the load. The plugin is closed when the last
+ * shared pointer created from it is released, the objects created with make_ptr or make_unique
+ * must be released by the caller before unloading.
+ *
+ * \tparam BaseType The base type of the factory.
+ * \tparam KeyType The key type of the factory.
+ * \tparam Policies The policies of the factory.
+ */
+template <typename BaseType, typename KeyType = std::string, typename Policies = factory_policies::defaults>
+class plugin_loader
+{
+  public:
+  using factory   = static_factory<BaseType, KeyType, Policies>;
+  using base_type = BaseType;
+  using key_type  = KeyType;
+
+  explicit plugin_loader(std::string interface) : m_interface{std::move(interface)}
+  {
+  }
+
+  plugin_loader(const plugin_loader&)            = delete;
+  plugin_loader& operator=(const plugin_loader&) = delete;
+
+  ~plugin_loader()
+  {
+    while(!m_plugins.empty())
+    {
+      unload(m_plugins.back().path);
+    }
+  }
+
+  //
+  // open the plugin at path and register its entries for the interface
+  // returns the number of registered keys, throws std::runtime_error if the plugin is invalid or
+  // one of its keys is already registered, nothing is registered then
+  //
+  size_t load(const std::string& path)
+  {
+    if(is_loaded(path))
+    {
+      return 0;
+    }
+
+    void* handle = ::dlopen(path.c_str(), RTLD_LAZY | RTLD_LOCAL);
+    if(!handle)
+    {
+      throw std::runtime_error(::dlerror());
+    }
+
+    auto lib = std::shared_ptr<library>(new library{handle});
+
+    auto table =
+      static_cast<const static_factory_plugin_table*>(::dlsym(handle, STATIC_FACTORY_PLUGIN_TABLE_SYMBOL));
+    if(!table || table->version != STATIC_FACTORY_PLUGIN_VERSION)
+    {
+      throw std::runtime_error(path + ": invalid static_factory plugin");
+    }
+
+    plugin loaded{path, {}, {}, {}};
+
+    for(uint32_t i = 0; i < table->count; ++i)
+    {
+      const auto& entry = table->entries[i];
+      if(m_interface != entry.interface)
+      {
+        continue;
+      }
+
+      auto resolved = std::make_shared<symbol>(lib, entry.create);
+
+      loaded.raw_creators.emplace_back(entry.key, creator<base_type*>{resolved});
+      loaded.shared_creators.emplace_back(entry.key, creator<std::shared_ptr<base_type>>{resolved});
+      loaded.unique_creators.emplace_back(entry.key, creator<std::unique_ptr<base_type>>{resolved});
+    }
+
+    // all the flavours under one lock: a make never sees the plugin partly registered
+    auto registered =
+      factory::try_register_functions(loaded.raw_creators, loaded.shared_creators, loaded.unique_creators);
+    if(!registered.empty())
+    {
+      std::string keys;
+      for(const auto& key : registered)
+      {
+        keys += " ";
+        keys += detail::key_view(key);
+      }
+      throw std::runtime_error(path + ": " + std::to_string(registered.size()) + " keys already registered" + keys);
+    }
+
+    m_plugins.push_back(std::move(loaded));
+
+    return m_plugins.back().raw_creators.size();
+  }
+
+  //
+  // unregister the functions the plugin at path registered, returns false if it is not loaded.
+  // the functions registered over the keys of the plugin since it was loaded are kept
+  //
+  bool unload(const std::string& path)
+  {
+    auto it = std::find_if(m_plugins.begin(),
+      m_plugins.end(),
+      [&path](const plugin& p)
+      {
+        return p.path == path;
+      });
+
+    if(it == m_plugins.end())
+    {
+      return false;
+    }
+
+    factory::unregister_functions(it->raw_creators, it->shared_creators, it->unique_creators);
+
+    m_plugins.erase(it);
+
+    return true;
+  }
+
+  bool is_loaded(const std::string& path) const
+  {
+    return std::any_of(m_plugins.begin(),
+      m_plugins.end(),
+      [&path](const plugin& p)
+      {
+        return p.path == path;
+      });
+  }
+
+  private:
+  struct library
+  {
+    void* handle;
+
+    ~library()
+    {
+      ::dlclose(handle);
+    }
+  };
+
+  // create function of an entry, resolved on first use
+  struct symbol
+  {
+    symbol(std::shared_ptr<library> l, std::string n) : lib{std::move(l)}, name{std::move(n)}
+    {
+    }
+
+    std::shared_ptr<library> lib;
+    std::string name;
+    std::atomic<void* (*)()> create{nullptr};
+
+    base_type* operator()()
+    {
+      auto func = create.load(std::memory_order_acquire);
+      if(!func)
+      {
+        func = reinterpret_cast<void* (*)()>(::dlsym(lib->handle, name.c_str()));
+        if(!func)
+        {
+          throw std::runtime_error("unresolved plugin symbol " + name);
+        }
+        create.store(func, std::memory_order_release);
+      }
+      return static_cast<base_type*>(func());
+    }
+  };
+
+  template <typename RetType>
+  struct creator
+  {
+    // kept out of the arena of static_factory::compact(), which would keep the plugin open
+    using static_factory_pinned_state = void;
+
+    std::shared_ptr<symbol> resolved;
+
+    // the creator registered by the plugin, see static_factory::unregister_functions
+    bool operator==(const creator&) const = default;
+
+    RetType operator()() const
+    {
+      if constexpr(std::is_pointer_v<RetType>)
+      {
+        return (*resolved)();
+      }
+      else if constexpr(detail::is_specialization_of_v<RetType, std::shared_ptr>)
+      {
+        // the object keeps the plugin loaded until it is released
+        return RetType((*resolved)(),
+          [lib = resolved->lib](base_type* obj)
+          {
+            delete obj;
+          });
+      }
+      else
+      {
+        return RetType((*resolved)());
+      }
+    }
+  };
+
+  struct plugin
+  {
+    std::string path;
+    std::vector<std::pair<key_type, creator<base_type*>>> raw_creators;
+    std::vector<std::pair<key_type, creator<std::shared_ptr<base_type>>>> shared_creators;
+    std::vector<std::pair<key_type, creator<std::unique_ptr<base_type>>>> unique_creators;
+  };
+
+  std::string m_interface;
+  std::vector<plugin> m_plugins;
+};
+
+#endif // STATIC_FACTORY_PLUGIN_H
@@ -0,0 +1,256 @@
+#ifndef STATIC_FACTORY_PROFILE_H
+#define STATIC_FACTORY_PROFILE_H
+
+#include "static_factory.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <typeinfo>
+#include <vector>
+
+/**
+ * \brief A registration recorded by registration_profiler.
+ */
+struct registration_record
+{
+  uint64_t start;                  // nanoseconds since the first registration recorded
+  uint64_t duration;               // nanoseconds, with the write lock held
+  size_t hash;
+  std::string key;                 // empty if the key is not convertible to a std::string_view
+  const std::type_info* type;      // the registered type, or the return type of the function
+  const std::type_info* signature; // void(*)(Args...), the argument types
+  const std::type_info* registry;  // the static_factory registered in
+  registry_usage usage;            // the size of the registry after the registration
+};
+
+/**
+ * \brief The registration_profiler class records the registrations of the factories compiled with profile_instrumentation.
+ *
+ * Every register_type, register_function, register_alternatives and register_deserializer call of
+ * a factory using factory_policies::profile_instrumentation is recorded with its duration, the
+ * registry it landed in and the size and bytes of that registry after it, including the ones run
+ * during the static initialization. The records are available at runtime with records(), and
+ * written by write_report() as a summary per registry followed by the slowest registrations.
+ *
+ * When STATIC_FACTORY_REGISTRATION_REPORT is set in the environment, the report is written at
+ * exit to the file it names, or to stderr if it is empty or "-".
+ */
+class registration_profiler
+{
+  public:
+  static std::vector<registration_record> records()
+  {
+    std::lock_guard lock(s_mutex);
+    return s_records;
+  }
+
+  static void clear()
+  {
+    std::lock_guard lock(s_mutex);
+    s_records.clear();
+  }
+
+  static void record(registration_record record)
+  {
+    std::lock_guard lock(s_mutex);
+
+    if(s_records.empty() && !s_exit_report_installed)
+    {
+      s_exit_report_installed = true;
+      if(std::getenv("STATIC_FACTORY_REGISTRATION_REPORT"))
+      {
+        std::atexit(&write_exit_report);
+      }
+    }
+    s_records.push_back(std::move(record));
+  }
+
+  // nanoseconds since the first call, the registrations may run before the dynamic initialization of the profiler
+  static uint64_t now()
+  {
+    static const auto epoch = std::chrono::steady_clock::now();
+
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - epoch).count());
+  }
+
+  //
+  // write the registrations per registry, then the slowest ones, at most slowest of them
+  //
+  static void write_report(std::FILE* file, size_t slowest = 20)
+  {
+    auto recorded = records();
+
+    struct registry_summary
+    {
+      const std::type_info* registry;
+      size_t registrations = 0;
+      uint64_t duration    = 0;
+      registry_usage usage{}; // after the last registration
+    };
+
+    std::vector<registry_summary> registries;
+    uint64_t total = 0;
+    for(auto& record : recorded)
+    {
+      auto it = std::find_if(registries.begin(),
+        registries.end(),
+        [&record](const registry_summary& summary)
+        {
+          return *summary.registry == *record.registry;
+        });
+      if(it == registries.end())
+      {
+        it = registries.insert(registries.end(), {record.registry});
+      }
+      it->registrations++;
+      it->duration += record.duration;
+      it->usage = record.usage;
+      total += record.duration;
+    }
+
+    std::sort(registries.begin(),
+      registries.end(),
+      [](const registry_summary& a, const registry_summary& b)
+      {
+        return a.duration > b.duration;
+      });
+
+    std::fprintf(file, "static_factory registrations: %zu in %.3f ms\n\n", recorded.size(), double(total) / 1e6);
+    std::fprintf(file, "%12s %8s %8s %10s %8s %10s  %s\n", "time (ms)", "calls", "keys", "functions", "states", "bytes", "registry");
+    for(auto& summary : registries)
+    {
+      std::fprintf(file,
+        "%12.3f %8zu %8zu %10zu %8zu %10zu  %s\n",
+        double(summary.duration) / 1e6,
+        summary.registrations,
+        summary.usage.keys,
+        summary.usage.functions,
+        summary.usage.states,
+        summary.usage.bytes,
+        detail::demangle(*summary.registry).c_str());
+    }
+
+    std::sort(recorded.begin(),
+      recorded.end(),
+      [](const registration_record& a, const registration_record& b)
+      {
+        return a.duration > b.duration;
+      });
+    recorded.resize(std::min(recorded.size(), slowest));
+
+    std::fprintf(file, "\nslowest registrations\n");
+    std::fprintf(file, "%12s %12s %10s  %s\n", "time (us)", "at (ms)", "bytes", "key: type(arguments) in registry");
+    for(auto& record : recorded)
+    {
+      auto key = record.key.empty() ? std::to_string(record.hash) : record.key;
+      std::fprintf(file,
+        "%12.3f %12.3f %10zu  %s: %s%s in %s\n",
+        double(record.duration) / 1e3,
+        double(record.start) / 1e6,
+        record.usage.bytes,
+        key.c_str(),
+        detail::demangle(*record.type).c_str(),
+        arguments(*record.signature).c_str(),
+        detail::demangle(*record.registry).c_str());
+    }
+  }
+
+  //
+  // write the report to the file at path, throws std::runtime_error if it cannot be written
+  //
+  static void write_report(const std::string& path, size_t slowest = 20)
+  {
+    std::unique_ptr<std::FILE, int (*)(std::FILE*)> file(std::fopen(path.c_str(), "w"), &std::fclose);
+    if(!file)
+    {
+      throw std::runtime_error("Cannot open registration report " + path);
+    }
+
+    write_report(file.get(), slowest);
+    if(std::ferror(file.get()))
+    {
+      throw std::runtime_error("Cannot write registration report " + path);
+    }
+  }
+
+  private:
+  static void write_exit_report()
+  {
+    std::string_view path = std::getenv("STATIC_FACTORY_REGISTRATION_REPORT");
+    if(path.empty() || path == "-")
+    {
+      write_report(stderr);
+      return;
+    }
+
+    try
+    {
+      write_report(std::string(path));
+    }
+    catch(const std::exception& e)
+    {
+      std::fprintf(stderr, "%s\n", e.what());
+    }
+  }
+
+  // "(Args...)" of a void(*)(Args...) signature
+  static std::string arguments(const std::type_info& signature)
+  {
+    auto name  = detail::demangle(signature);
+    auto start = name.find("(*)");
+    return start == std::string::npos ? name : name.substr(start + 3);
+  }
+
+  static inline std::mutex s_mutex;
+  static inline std::vector<registration_record> s_records;
+  static inline bool s_exit_report_installed = false;
+};
+
+namespace factory_policies
+{
+
+// record the registrations to registration_profiler
+struct profile_instrumentation : no_instrumentation
+{
+  struct register_scope
+  {
+    explicit register_scope(const detail::register_call& call)
+      : m_call{call},
+        m_start{registration_profiler::now()}
+    {
+    }
+
+    register_scope(const register_scope&)            = delete;
+    register_scope& operator=(const register_scope&) = delete;
+
+    ~register_scope()
+    {
+      auto end = registration_profiler::now();
+      registration_profiler::record({m_start,
+        end - m_start,
+        m_call.hash,
+        std::string(m_call.key),
+        &m_call.type,
+        &m_call.signature,
+        &m_call.registry,
+        m_call.usage()});
+    }
+
+    private:
+    detail::register_call m_call;
+    uint64_t m_start;
+  };
+};
+
+} // namespace factory_policies
+
+#endif // STATIC_FACTORY_PROFILE_H
@@ -0,0 +1,286 @@
+#ifndef STATIC_FACTORY_SAMPLING_H
+#define STATIC_FACTORY_SAMPLING_H
+
+#include "static_factory_trace.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace detail
+{
+
+inline constexpr size_t sampling_buckets = 40;
+
+// the counters of one thread: written by their thread only, read by factory_sampler::snapshot
+struct sampling_slot
+{
+  std::atomic<uint64_t> calls     = 0;
+  std::atomic<uint64_t> sampled   = 0;
+  std::atomic<uint64_t> lock_wait = 0; // nanoseconds, of the sampled calls
+  std::atomic<uint64_t> duration  = 0; // nanoseconds after the lock, of the sampled calls
+  std::array<std::atomic<uint64_t>, sampling_buckets> histogram{}; // sampled calls per log2 of their latency
+
+  uint32_t countdown = 1; // calls until the next sample, owner thread only
+
+  // increment without a locked instruction, the thread is the only writer
+  static void add(std::atomic<uint64_t>& counter, uint64_t value)
+  {
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+  }
+};
+
+} // namespace detail
+
+/**
+ * \brief The statistics of the calls of the factories compiled with sampling_instrumentation.
+ */
+struct sampling_stats
+{
+  uint64_t calls     = 0; // make* and try_make* calls
+  uint64_t sampled   = 0; // calls fully instrumented
+  uint64_t lock_wait = 0; // nanoseconds waiting for the lock, summed over the sampled calls
+  uint64_t duration  = 0; // nanoseconds after the lock, summed over the sampled calls
+  std::array<uint64_t, detail::sampling_buckets> histogram{}; // sampled calls by latency: bucket b holds [2^b, 2^(b+1)) ns
+
+  double mean_latency() const
+  {
+    return sampled ? double(lock_wait + duration) / double(sampled) : 0;
+  }
+
+  // the total time spent in the calls, extrapolated from the samples, in nanoseconds
+  double estimated_total() const
+  {
+    return mean_latency() * double(calls);
+  }
+
+  // upper bound of the latency of the fraction p of the sampled calls, in nanoseconds
+  uint64_t percentile(double p) const
+  {
+    uint64_t rank  = uint64_t(p * double(sampled));
+    uint64_t count = 0;
+    for(size_t b = 0; b < histogram.size(); ++b)
+    {
+      count += histogram[b];
+      if(count > rank)
+      {
+        return uint64_t(2) << b;
+      }
+    }
+    return 0;
+  }
+};
+
+/**
+ * \brief The factory_sampler class fully instruments one in period calls of the sampling factories.
+ *
+ * Every call of a factory using factory_policies::sampling_instrumentation increments a counter
+ * of its thread and decrements a countdown of its thread. The call that reaches zero is timed,
+ * like with trace_instrumentation, and is recorded by factory_tracer when it is active.
+ * The cost of the other calls is a thread local increment, a decrement and a branch.
+ *
+ * set_period() applies to each thread from its next sample. The counters are written without
+ * locked instructions and read with relaxed loads: a snapshot() taken during calls may miss the
+ * last of them, and the counts of the calls concurrent with reset() may be lost.
+ */
+class factory_sampler
+{
+  public:
+  // one in period calls is sampled, the countdowns of the threads are reloaded with it
+  static void set_period(uint32_t period)
+  {
+    s_period.store(std::max<uint32_t>(period, 1), std::memory_order_relaxed);
+  }
+
+  static uint32_t period()
+  {
+    return s_period.load(std::memory_order_relaxed);
+  }
+
+  // the counters of all the threads, including the threads that exited
+  static sampling_stats snapshot()
+  {
+    std::lock_guard lock(s_mutex);
+
+    sampling_stats stats = s_retired;
+    for(auto& slot : s_slots)
+    {
+      accumulate(stats, *slot);
+    }
+    return stats;
+  }
+
+  static void reset()
+  {
+    std::lock_guard lock(s_mutex);
+
+    s_retired = {};
+    for(auto& slot : s_slots)
+    {
+      slot->calls.store(0, std::memory_order_relaxed);
+      slot->sampled.store(0, std::memory_order_relaxed);
+      slot->lock_wait.store(0, std::memory_order_relaxed);
+      slot->duration.store(0, std::memory_order_relaxed);
+      for(auto& bucket : slot->histogram)
+      {
+        bucket.store(0, std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // count a call of the thread, true if it is sampled
+  static bool count(detail::sampling_slot*& slot)
+  {
+    slot = t_slot ? t_slot : local_slot();
+
+    detail::sampling_slot::add(slot->calls, 1);
+    if(--slot->countdown != 0)
+    {
+      return false;
+    }
+    slot->countdown = period();
+    return true;
+  }
+
+  static void record(detail::sampling_slot& slot, uint64_t lock_wait, uint64_t duration)
+  {
+    auto latency = std::max<uint64_t>(lock_wait + duration, 1);
+    auto bucket  = std::min<size_t>(size_t(std::bit_width(latency) - 1), detail::sampling_buckets - 1);
+
+    detail::sampling_slot::add(slot.sampled, 1);
+    detail::sampling_slot::add(slot.lock_wait, lock_wait);
+    detail::sampling_slot::add(slot.duration, duration);
+    detail::sampling_slot::add(slot.histogram[bucket], 1);
+  }
+
+  private:
+  // registers the slot of the thread, merged into the retired counters at the thread exit
+  struct slot_owner
+  {
+    std::shared_ptr<detail::sampling_slot> slot = std::make_shared<detail::sampling_slot>();
+
+    slot_owner()
+    {
+      std::lock_guard lock(s_mutex);
+      s_slots.push_back(slot);
+    }
+
+    ~slot_owner()
+    {
+      std::lock_guard lock(s_mutex);
+      accumulate(s_retired, *slot);
+      std::erase(s_slots, slot);
+      t_slot = nullptr;
+    }
+  };
+
+  static detail::sampling_slot* local_slot()
+  {
+    thread_local slot_owner owner;
+
+    // the first sample of a thread is at a random phase of the period, so that threads making
+    // calls in lockstep are not all sampled together
+    auto seed             = uint64_t(reinterpret_cast<uintptr_t>(owner.slot.get())) * 0x9e3779b97f4a7c15ull;
+    owner.slot->countdown = uint32_t(seed >> 40) % period() + 1;
+    t_slot                = owner.slot.get();
+    return t_slot;
+  }
+
+  static void accumulate(sampling_stats& stats, const detail::sampling_slot& slot)
+  {
+    stats.calls += slot.calls.load(std::memory_order_relaxed);
+    stats.sampled += slot.sampled.load(std::memory_order_relaxed);
+    stats.lock_wait += slot.lock_wait.load(std::memory_order_relaxed);
+    stats.duration += slot.duration.load(std::memory_order_relaxed);
+    for(size_t b = 0; b < slot.histogram.size(); ++b)
+    {
+      stats.histogram[b] += slot.histogram[b].load(std::memory_order_relaxed);
+    }
+  }
+
+  static inline std::mutex s_mutex;
+  static inline std::atomic<uint32_t> s_period = 1024;
+  static inline std::vector<std::shared_ptr<detail::sampling_slot>> s_slots;
+  static inline sampling_stats s_retired;
+  static inline thread_local detail::sampling_slot* t_slot = nullptr; // trivially initialized, no guard
+};
+
+namespace factory_policies
+{
+
+// count every call and fully instrument one in factory_sampler::period() of them
+struct sampling_instrumentation
+{
+  struct scope
+  {
+    explicit scope(const detail::make_call& call)
+    {
+      if(factory_sampler::count(m_slot))
+      {
+        m_hash      = call.hash;
+        m_signature = &call.signature;
+        m_any_key   = call.any_key;
+        m_start     = factory_tracer::now();
+        m_locked = m_start;
+      }
+    }
+
+    scope(const scope&)            = delete;
+    scope& operator=(const scope&) = delete;
+
+    void locked()
+    {
+      if(m_signature)
+      {
+        m_locked = factory_tracer::now();
+      }
+    }
+
+    ~scope()
+    {
+      if(m_signature)
+      {
+        auto end = factory_tracer::now();
+        factory_sampler::record(*m_slot, m_locked - m_start, end - m_locked);
+
+        if(factory_tracer::active())
+        {
+          factory_tracer::record({m_start,
+            m_hash,
+            m_signature,
+            nullptr,
+            uint32_t(std::min<uint64_t>(m_locked - m_start, UINT32_MAX)),
+            uint32_t(std::min<uint64_t>(end - m_locked, UINT32_MAX)),
+            m_any_key ? detail::trace_kind::try_make : detail::trace_kind::make});
+        }
+      }
+    }
+
+    private:
+    // copied from the call, which is a temporary of the make* statement
+    detail::sampling_slot* m_slot     = nullptr;
+    size_t m_hash                     = 0;
+    const std::type_info* m_signature = nullptr; // set if the call is sampled
+    bool m_any_key                    = false;
+    uint64_t m_start                  = 0;
+    uint64_t m_locked                 = 0;
+  };
+
+  // the keys are named for the sampled calls recorded by factory_tracer
+  struct register_scope
+  {
+    explicit register_scope(const detail::register_call& call)
+    {
+      factory_tracer::name(call.hash, call.key);
+    }
+  };
+};
+
+} // namespace factory_policies
+
+#endif // STATIC_FACTORY_SAMPLING_H
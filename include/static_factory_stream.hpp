@@ -0,0 +1,485 @@
+#ifndef STATIC_FACTORY_STREAM_H
+#define STATIC_FACTORY_STREAM_H
+
+#include "static_factory.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <cerrno>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//
+// record format of a stream, repeated until the end of the file:
+//
+//   uint32_t key_size      native endianness
+//   uint32_t payload_size  native endianness
+//   key_size bytes         the key the record is registered under
+//   payload_size bytes     the bytes given to the deserializer registered under the key
+//
+
+namespace detail
+{
+
+// fifo of at most capacity elements, shared by one producer and one consumer stage
+template <typename T>
+class bounded_queue
+{
+  public:
+  explicit bounded_queue(size_t capacity) : m_capacity{capacity}
+  {
+  }
+
+  // false if the queue was closed
+  bool push(T value)
+  {
+    std::unique_lock lock(m_mutex);
+    m_not_full.wait(lock,
+      [this]
+      {
+        return m_closed || m_items.size() < m_capacity;
+      });
+    if(m_closed)
+    {
+      return false;
+    }
+    m_items.push_back(std::move(value));
+    m_not_empty.notify_one();
+    return true;
+  }
+
+  // empty once the queue is closed and drained
+  std::optional<T> pop()
+  {
+    std::unique_lock lock(m_mutex);
+    m_not_empty.wait(lock,
+      [this]
+      {
+        return m_closed || !m_items.empty();
+      });
+    if(m_items.empty())
+    {
+      return std::nullopt;
+    }
+    auto value = std::move(m_items.front());
+    m_items.pop_front();
+    m_not_full.notify_one();
+    return value;
+  }
+
+  // no more push, the pending elements can still be popped
+  void close()
+  {
+    std::lock_guard lock(m_mutex);
+    m_closed = true;
+    m_not_empty.notify_all();
+    m_not_full.notify_all();
+  }
+
+  private:
+  size_t m_capacity;
+  bool m_closed = false;
+  std::deque<T> m_items;
+  std::mutex m_mutex;
+  std::condition_variable m_not_empty;
+  std::condition_variable m_not_full;
+};
+
+struct record_header
+{
+  uint32_t key_size;
+  uint32_t payload_size;
+};
+
+// size of the first record of bytes, throws std::runtime_error if it is truncated
+inline size_t first_record_size(std::span<const std::byte> bytes)
+{
+  record_header header;
+  if(bytes.size() >= sizeof(header))
+  {
+    std::memcpy(&header, bytes.data(), sizeof(header));
+
+    auto size = sizeof(header) + size_t(header.key_size) + header.payload_size;
+    if(bytes.size() >= size)
+    {
+      return size;
+    }
+  }
+  throw std::runtime_error("truncated record at the end of the stream");
+}
+
+// size of the complete records at the beginning of bytes
+inline size_t complete_records_size(std::span<const std::byte> bytes)
+{
+  size_t offset = 0;
+  while(bytes.size() - offset >= sizeof(record_header))
+  {
+    record_header header;
+    std::memcpy(&header, bytes.data() + offset, sizeof(header));
+
+    auto size = sizeof(header) + size_t(header.key_size) + header.payload_size;
+    if(bytes.size() - offset < size)
+    {
+      break;
+    }
+    offset += size;
+  }
+  return offset;
+}
+
+} // namespace detail
+
+/**
+ * \brief The record_stream class makes the objects of the records read from a file descriptor.
+ *
+ * The records are processed by three stages running concurrently: a reader maps the file, or
+ * reads the pipe in large chunks, and splits it on record boundaries; a lookup stage parses the
+ * records of a chunk and hashes their keys; a builder makes the objects of a batch with the
+ * deserializers registered in the factory (see static_factory::register_deserializer).
+ * The stages are connected by bounded queues, so a slow consumer throttles the reading.
+ *
+ * The objects are handed out in batches holding the bytes they were made from: objects keeping
+ * views into their payload are valid as long as their batch.
+ *
+ * \tparam Factory The static_factory the deserializers are registered in.
+ */
+template <typename Factory>
+class record_stream
+{
+  public:
+  using factory   = Factory;
+  using base_type = typename Factory::base_type;
+  using key_type  = typename Factory::key_type;
+
+  static_assert(std::is_constructible_v<key_type, std::string_view>,
+    "The key type must be constructible from a std::string_view");
+
+  struct options
+  {
+    size_t read_size      = size_t(1) << 20; // bytes per chunk, read or mapped
+    size_t batch_size     = 256;             // records per batch
+    size_t queue_capacity = 16;              // batches buffered between two stages
+    bool use_mmap         = true;            // map regular files instead of reading them
+  };
+
+  // bytes of the stream the records of a batch were parsed from
+  struct chunk
+  {
+    std::shared_ptr<void> owner; // the mapping or the read buffer
+    std::span<const std::byte> bytes;
+  };
+
+  struct batch
+  {
+    std::vector<typename Factory::decoded_type> objects;
+    std::vector<std::shared_ptr<const chunk>> chunks;
+  };
+
+  //
+  // start reading fd, which stays owned by the caller and must stay open until the stream is
+  // destroyed. destroying the stream before the end waits for the pending read of a pipe
+  //
+  explicit record_stream(int fd, options opts = {})
+    : m_fd{fd},
+      m_options{opts},
+      m_chunks{opts.queue_capacity},
+      m_records{opts.queue_capacity},
+      m_batches{opts.queue_capacity},
+      m_start{std::chrono::steady_clock::now()}
+  {
+    m_reader = std::thread(
+      [this]
+      {
+        stage(&record_stream::read, m_chunks);
+      });
+    m_parser = std::thread(
+      [this]
+      {
+        stage(&record_stream::parse, m_records);
+      });
+    m_builder = std::thread(
+      [this]
+      {
+        stage(&record_stream::build, m_batches);
+      });
+  }
+
+  record_stream(const record_stream&)            = delete;
+  record_stream& operator=(const record_stream&) = delete;
+
+  ~record_stream()
+  {
+    m_chunks.close();
+    m_records.close();
+    m_batches.close();
+
+    m_reader.join();
+    m_parser.join();
+    m_builder.join();
+  }
+
+  //
+  // next batch of objects, in the order of the records. false at the end of the stream
+  // rethrows the errors of the stages, e.g. a record of an unknown key
+  //
+  bool next(batch& result)
+  {
+    auto next_batch = m_batches.pop();
+    if(!next_batch)
+    {
+      m_end = std::chrono::steady_clock::now();
+
+      std::lock_guard lock(m_error_mutex);
+      if(m_error)
+      {
+        std::rethrow_exception(m_error);
+      }
+      return false;
+    }
+
+    result = std::move(*next_batch);
+    m_record_count += result.objects.size();
+    return true;
+  }
+
+  // records handed out so far
+  size_t records() const
+  {
+    return m_record_count;
+  }
+
+  // records handed out per second, since the construction until the end of the stream
+  double records_per_second() const
+  {
+    auto end     = m_end.value_or(std::chrono::steady_clock::now());
+    auto seconds = std::chrono::duration<double>(end - m_start).count();
+    return seconds > 0 ? double(m_record_count) / seconds : 0;
+  }
+
+  private:
+  // records of a chunk, with their keys hashed
+  struct parsed_records
+  {
+    std::shared_ptr<const chunk> source;
+    std::vector<std::pair<typename factory::prepared_key, std::span<const std::byte>>> records;
+  };
+
+  struct mapping
+  {
+    void* address;
+    size_t size;
+
+    ~mapping()
+    {
+      ::munmap(address, size);
+    }
+  };
+
+  // run a stage, then close its output so that the next stage ends once drained
+  template <typename Output>
+  void stage(void (record_stream::*body)(), Output& output)
+  {
+    try
+    {
+      (this->*body)();
+    }
+    catch(...)
+    {
+      std::lock_guard lock(m_error_mutex);
+      if(!m_error)
+      {
+        m_error = std::current_exception();
+      }
+      m_chunks.close();
+      m_records.close();
+    }
+    output.close();
+  }
+
+  void read()
+  {
+    struct stat status;
+    if(m_options.use_mmap && ::fstat(m_fd, &status) == 0 && S_ISREG(status.st_mode) && status.st_size > 0)
+    {
+      read_mapped(size_t(status.st_size));
+    }
+    else
+    {
+      read_chunks();
+    }
+  }
+
+  void read_mapped(size_t size)
+  {
+    void* address = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+    if(address == MAP_FAILED)
+    {
+      throw std::system_error(errno, std::generic_category(), "mmap");
+    }
+    ::madvise(address, size, MADV_SEQUENTIAL);
+
+    auto map   = std::shared_ptr<mapping>(new mapping{address, size});
+    auto bytes = std::span<const std::byte>(static_cast<const std::byte*>(address), size);
+
+    while(!bytes.empty())
+    {
+      // whole records of at least read_size bytes, or the record larger than read_size
+      auto records = detail::complete_records_size(bytes.first(std::min(bytes.size(), m_options.read_size)));
+      if(records == 0)
+      {
+        records = detail::first_record_size(bytes);
+      }
+
+      if(!m_chunks.push(std::make_shared<const chunk>(chunk{map, bytes.first(records)})))
+      {
+        return;
+      }
+      bytes = bytes.subspan(records);
+    }
+  }
+
+  void read_chunks()
+  {
+    std::vector<std::byte> pending;
+
+    for(;;)
+    {
+      // the bytes of the incomplete record of the previous read, followed by at least read_size bytes
+      auto buffer = std::make_shared<std::vector<std::byte>>(std::move(pending));
+      auto filled = buffer->size();
+      buffer->resize(std::max(filled * 2, filled + m_options.read_size));
+
+      // a pipe or a socket returns less than asked: read until the buffer is full or the end
+      bool end = false;
+      while(!end && filled < buffer->size())
+      {
+        auto count = ::read(m_fd, buffer->data() + filled, buffer->size() - filled);
+        if(count < 0 && errno != EINTR)
+        {
+          throw std::system_error(errno, std::generic_category(), "read");
+        }
+        end = count == 0;
+        filled += size_t(std::max<ssize_t>(count, 0));
+      }
+      buffer->resize(filled);
+
+      auto records = detail::complete_records_size(*buffer);
+
+      pending.assign(buffer->begin() + ptrdiff_t(records), buffer->end());
+
+      if(records != 0)
+      {
+        std::span<const std::byte> bytes(buffer->data(), records);
+        if(!m_chunks.push(std::make_shared<const chunk>(chunk{buffer, bytes})))
+        {
+          return;
+        }
+      }
+
+      if(end)
+      {
+        if(!pending.empty())
+        {
+          detail::first_record_size(pending);
+        }
+        return;
+      }
+    }
+  }
+
+  void parse()
+  {
+    while(auto source = m_chunks.pop())
+    {
+      auto bytes = (*source)->bytes;
+
+      parsed_records parsed{*source, {}};
+      parsed.records.reserve(m_options.batch_size);
+
+      while(!bytes.empty())
+      {
+        detail::record_header header;
+        std::memcpy(&header, bytes.data(), sizeof(header));
+
+        auto key     = std::string_view(reinterpret_cast<const char*>(bytes.data() + sizeof(header)), header.key_size);
+        auto payload = bytes.subspan(sizeof(header) + header.key_size, header.payload_size);
+
+        parsed.records.emplace_back(factory::prepare(key_type(key)), payload);
+        bytes = bytes.subspan(sizeof(header) + header.key_size + header.payload_size);
+
+        if(parsed.records.size() == m_options.batch_size)
+        {
+          if(!m_records.push(std::move(parsed)))
+          {
+            return;
+          }
+          parsed = parsed_records{*source, {}};
+          parsed.records.reserve(m_options.batch_size);
+        }
+      }
+
+      if(!parsed.records.empty() && !m_records.push(std::move(parsed)))
+      {
+        return;
+      }
+    }
+  }
+
+  void build()
+  {
+    while(auto parsed = m_records.pop())
+    {
+      batch result;
+      result.objects.reserve(parsed->records.size());
+      result.chunks.push_back(std::move(parsed->source));
+
+      for(auto& [key, payload] : parsed->records)
+      {
+        result.objects.push_back(factory::make_from_bytes(key, payload));
+      }
+
+      if(!m_batches.push(std::move(result)))
+      {
+        return;
+      }
+    }
+  }
+
+  int m_fd;
+  options m_options;
+
+  detail::bounded_queue<std::shared_ptr<const chunk>> m_chunks;
+  detail::bounded_queue<parsed_records> m_records;
+  detail::bounded_queue<batch> m_batches;
+
+  std::mutex m_error_mutex;
+  std::exception_ptr m_error;
+
+  size_t m_record_count = 0;
+  std::chrono::steady_clock::time_point m_start;
+  std::optional<std::chrono::steady_clock::time_point> m_end;
+
+  std::thread m_reader;
+  std::thread m_parser;
+  std::thread m_builder;
+};
+
+#endif // STATIC_FACTORY_STREAM_H
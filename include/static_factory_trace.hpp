@@ -0,0 +1,393 @@
+#ifndef STATIC_FACTORY_TRACE_H
+#define STATIC_FACTORY_TRACE_H
+
+#include "static_factory.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <typeinfo>
+#include <unordered_map>
+#include <vector>
+
+namespace detail
+{
+
+enum class trace_kind : uint8_t
+{
+  make,
+  try_make,
+  register_key
+};
+
+struct trace_event
+{
+  uint64_t start;                  // nanoseconds since the epoch of the tracer
+  uint64_t hash;                   // hash of the key, 0 for try_make*
+  const std::type_info* signature; // RetType(*)(Args...), void(*)(Args...) for the registrations
+  const std::type_info* type;      // the registered type, nullptr for the calls
+  uint32_t lock_wait;              // nanoseconds waiting for the lock
+  uint32_t duration;               // nanoseconds from the lock to the end of the call
+  trace_kind kind;
+};
+
+// fixed size ring of the events of one thread: written by its thread without locking, read by
+// factory_tracer::write_chrome_trace. the oldest events are overwritten when it is full
+class trace_ring
+{
+  public:
+  explicit trace_ring(size_t capacity, uint32_t thread) : m_slots(capacity), m_thread{thread}
+  {
+  }
+
+  // the sequence of the slot is odd while the event is written, 2 * (index + 1) once it is written
+  void push(const trace_event& event)
+  {
+    auto head  = m_head.load(std::memory_order_relaxed);
+    auto& slot = m_slots[head % m_slots.size()];
+    slot.sequence.store(2 * head + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.event = event;
+    slot.sequence.store(2 * head + 2, std::memory_order_release);
+    m_head.store(head + 1, std::memory_order_release);
+  }
+
+  //
+  // append the events not read yet to output, returns the number of events overwritten before
+  // they could be read. the events are read while the thread may write: an event whose slot is
+  // written before or during its copy is dropped
+  //
+  size_t drain(std::vector<trace_event>& output)
+  {
+    auto head  = m_head.load(std::memory_order_acquire);
+    auto first = std::max(m_tail, head > m_slots.size() ? head - m_slots.size() : 0);
+    auto lost  = first - m_tail;
+
+    for(auto i = first; i < head; ++i)
+    {
+      auto& slot    = m_slots[i % m_slots.size()];
+      auto sequence = 2 * i + 2;
+      auto written  = slot.sequence.load(std::memory_order_acquire) == sequence;
+      auto event    = slot.event;
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if(written && slot.sequence.load(std::memory_order_relaxed) == sequence)
+      {
+        output.push_back(event);
+      }
+      else
+      {
+        ++lost;
+      }
+    }
+
+    m_tail = head;
+    return lost;
+  }
+
+  uint32_t thread() const
+  {
+    return m_thread;
+  }
+
+  private:
+  struct slot
+  {
+    std::atomic<uint64_t> sequence = 0;
+    trace_event event{};
+  };
+
+  std::vector<slot> m_slots;
+  std::atomic<uint64_t> m_head = 0;
+  uint64_t m_tail              = 0; // guarded by the mutex of the tracer
+  uint32_t m_thread;
+};
+
+} // namespace detail
+
+/**
+ * \brief The factory_tracer class records the activity of the factories compiled with trace_instrumentation.
+ *
+ * Between start() and stop(), every make*, try_make* and registration of a factory using
+ * factory_policies::trace_instrumentation is recorded in a ring buffer of the calling thread,
+ * without locking, with its key, its signature, the time spent waiting for the lock of the
+ * factory and the time spent after it. write_chrome_trace() drains the buffers into a Chrome
+ * trace JSON file, to open with chrome://tracing or https://ui.perfetto.dev.
+ *
+ * The keys are named from their registrations in the traced factories, whether the tracer is
+ * active or not; the keys that are not strings are written as their hash. The rings are drained
+ * while their threads may write: events overwritten during the copy are dropped and counted as lost.
+ */
+class factory_tracer
+{
+  public:
+  //
+  // start recording, in rings of events_per_thread events
+  //
+  static void start(size_t events_per_thread = 1 << 16)
+  {
+    std::lock_guard lock(s_mutex);
+
+    s_capacity = std::max<size_t>(events_per_thread, 1);
+    s_session.fetch_add(1, std::memory_order_relaxed);
+    s_active.store(true, std::memory_order_release);
+  }
+
+  static void stop()
+  {
+    s_active.store(false, std::memory_order_release);
+  }
+
+  static bool active()
+  {
+    return s_active.load(std::memory_order_acquire);
+  }
+
+  // nanoseconds since the epoch of the tracer
+  static uint64_t now()
+  {
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - s_epoch).count());
+  }
+
+  static void record(const detail::trace_event& event)
+  {
+    local_ring().push(event);
+  }
+
+  // name the key hash, for the events of the key
+  static void name(uint64_t hash, std::string_view key)
+  {
+    if(key.empty())
+    {
+      return;
+    }
+
+    std::lock_guard lock(s_mutex);
+    s_names.try_emplace(hash, key);
+  }
+
+  //
+  // drain the rings of all the threads into a Chrome trace JSON file at path
+  // returns the number of events written, throws std::runtime_error if the file cannot be written
+  //
+  static size_t write_chrome_trace(const std::string& path)
+  {
+    std::unique_ptr<std::FILE, int (*)(std::FILE*)> file(std::fopen(path.c_str(), "w"), &std::fclose);
+    if(!file)
+    {
+      throw std::runtime_error("Cannot open trace file " + path);
+    }
+
+    std::lock_guard lock(s_mutex);
+
+    std::fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n", file.get());
+
+    size_t written = 0;
+    size_t lost    = 0;
+    std::vector<detail::trace_event> events;
+    for(auto& ring : s_rings)
+    {
+      events.clear();
+      lost += ring->drain(events);
+
+      for(auto& event : events)
+      {
+        write_event(file.get(), event, ring->thread(), written++ == 0);
+      }
+    }
+
+    std::fprintf(file.get(), "\n],\"otherData\":{\"lost_events\":%zu}}\n", lost);
+
+    // the rings of the threads that exited or restarted since are drained for good
+    std::erase_if(s_rings,
+      [](const auto& ring)
+      {
+        return ring.use_count() == 1;
+      });
+
+    if(std::ferror(file.get()))
+    {
+      throw std::runtime_error("Cannot write trace file " + path);
+    }
+    return written;
+  }
+
+  private:
+  static detail::trace_ring& local_ring()
+  {
+    thread_local std::shared_ptr<detail::trace_ring> ring;
+    thread_local size_t session = 0;
+
+    auto current = s_session.load(std::memory_order_relaxed);
+    if(session != current)
+    {
+      // first event of the thread since start(): the previous ring stays readable until written
+      std::lock_guard lock(s_mutex);
+      ring = std::make_shared<detail::trace_ring>(s_capacity, s_thread_count++);
+      s_rings.push_back(ring);
+      session = current;
+    }
+    return *ring;
+  }
+
+  // the string as the body of a JSON string
+  static std::string escape(std::string_view str)
+  {
+    std::string result;
+    for(char c : str)
+    {
+      if(c == '"' || c == '\\')
+      {
+        result += '\\';
+        result += c;
+      }
+      else if(static_cast<unsigned char>(c) < 0x20)
+      {
+        char code[8];
+        std::snprintf(code, sizeof(code), "\\u%04x", c);
+        result += code;
+      }
+      else
+      {
+        result += c;
+      }
+    }
+    return result;
+  }
+
+  static void write_event(std::FILE* file, const detail::trace_event& event, uint32_t thread, bool first)
+  {
+    static const char* kinds[] = {"make", "try_make", "register"};
+
+    std::string key;
+    if(event.kind != detail::trace_kind::try_make)
+    {
+      auto it = s_names.find(event.hash);
+      key     = it != s_names.end() ? escape(it->second) : std::to_string(event.hash);
+    }
+
+    std::fprintf(file,
+      "%s{\"name\":\"%s%s%s\",\"cat\":\"static_factory\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,"
+      "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"key\":\"%s\",\"signature\":\"%s\",",
+      first ? "" : ",\n",
+      kinds[size_t(event.kind)],
+      key.empty() ? "" : " ",
+      key.c_str(),
+      thread,
+      double(event.start) / 1000,
+      double(uint64_t(event.lock_wait) + event.duration) / 1000,
+      key.c_str(),
+      escape(detail::demangle(*event.signature)).c_str());
+
+    if(event.type)
+    {
+      std::fprintf(file, "\"type\":\"%s\",", escape(detail::demangle(*event.type)).c_str());
+    }
+
+    std::fprintf(file, "\"lock_wait_ns\":%u,\"duration_ns\":%u}}", event.lock_wait, event.duration);
+  }
+
+  static inline std::mutex s_mutex;
+  static inline std::atomic<bool> s_active                     = false;
+  static inline std::atomic<size_t> s_session                  = 0;
+  static inline size_t s_capacity                              = 1 << 16;
+  static inline uint32_t s_thread_count                        = 0;
+  static inline const std::chrono::steady_clock::time_point s_epoch = std::chrono::steady_clock::now();
+  static inline std::vector<std::shared_ptr<detail::trace_ring>> s_rings;
+  static inline std::unordered_map<uint64_t, std::string> s_names;
+};
+
+namespace factory_policies
+{
+
+// record the calls and the registrations to factory_tracer while it is active
+struct trace_instrumentation
+{
+  struct scope
+  {
+    explicit scope(const detail::make_call& call)
+    {
+      if(factory_tracer::active())
+      {
+        m_event = {factory_tracer::now(),
+          call.hash,
+          &call.signature,
+          nullptr,
+          0,
+          0,
+          call.any_key ? detail::trace_kind::try_make : detail::trace_kind::make};
+        m_locked = m_event.start;
+      }
+    }
+
+    scope(const scope&)            = delete;
+    scope& operator=(const scope&) = delete;
+
+    void locked()
+    {
+      if(m_event.signature)
+      {
+        m_locked = factory_tracer::now();
+      }
+    }
+
+    ~scope()
+    {
+      if(m_event.signature)
+      {
+        auto end          = factory_tracer::now();
+        m_event.lock_wait = uint32_t(std::min<uint64_t>(m_locked - m_event.start, UINT32_MAX));
+        m_event.duration  = uint32_t(std::min<uint64_t>(end - m_locked, UINT32_MAX));
+        factory_tracer::record(m_event);
+      }
+    }
+
+    private:
+    detail::trace_event m_event{};
+    uint64_t m_locked = 0;
+  };
+
+  // the write lock is already held: the whole registration is reported as its duration
+  struct register_scope
+  {
+    explicit register_scope(const detail::register_call& call)
+      : m_event{0, call.hash, &call.signature, &call.type, 0, 0, detail::trace_kind::register_key}
+    {
+      factory_tracer::name(call.hash, call.key);
+      if(factory_tracer::active())
+      {
+        m_event.start = factory_tracer::now();
+      }
+      else
+      {
+        m_event.signature = nullptr;
+      }
+    }
+
+    register_scope(const register_scope&)            = delete;
+    register_scope& operator=(const register_scope&) = delete;
+
+    ~register_scope()
+    {
+      if(m_event.signature)
+      {
+        m_event.duration = uint32_t(std::min<uint64_t>(factory_tracer::now() - m_event.start, UINT32_MAX));
+        factory_tracer::record(m_event);
+      }
+    }
+
+    private:
+    detail::trace_event m_event;
+  };
+};
+
+} // namespace factory_policies
+
+#endif // STATIC_FACTORY_TRACE_H
@@ -0,0 +1,35 @@
+//
+// static_factory module: the header compiled once into a module interface, for the translation
+// units that import it instead of including static_factory.hpp.
+// the registration macros (STATIC_FACTORY_REGISTER, STATIC_FACTORY_DECLARE, ...) are not
+// exported by a module, the translation units using them must include the header.
+//
+
+module;
+
+#include <static_factory.hpp>
+
+export module static_factory;
+
+export using ::static_factory;
+export using ::lazy_ptr;
+export using ::registry_usage;
+export using ::constexpr_entry;
+export using ::constexpr_factory;
+export using ::generated_factory;
+
+export namespace factory_policies
+{
+using factory_policies::mutex_locking;
+using factory_policies::shared_mutex_locking;
+using factory_policies::no_locking;
+using factory_policies::linear_storage;
+using factory_policies::hashed_storage;
+using factory_policies::std_hash;
+using factory_policies::throw_on_error;
+using factory_policies::nothrow_on_error;
+using factory_policies::exact_dispatch;
+using factory_policies::converting_dispatch;
+using factory_policies::no_instrumentation;
+using factory_policies::defaults;
+} // namespace factory_policies
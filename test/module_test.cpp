@@ -0,0 +1,45 @@
+// built with BUILD_MODULE=ON when the toolchain supports modules: the factory is only imported,
+// the standard headers are not included after the import
+import static_factory;
+
+namespace
+{
+
+class ModuleBase
+{
+  public:
+  virtual ~ModuleBase()        = default;
+  virtual int getValue() const = 0;
+};
+
+class ModuleClass : public ModuleBase
+{
+  public:
+  explicit ModuleClass(int value) : m_value{value}
+  {
+  }
+
+  int getValue() const override
+  {
+    return m_value;
+  }
+
+  private:
+  int m_value;
+};
+
+using module_factory = static_factory<ModuleBase, int, factory_policies::defaults>;
+
+} // namespace
+
+int main()
+{
+  module_factory::register_type<ModuleClass, int>(1);
+
+  if(!module_factory::contains(1) || module_factory::contains(2))
+  {
+    return 1;
+  }
+
+  return module_factory::make_unique(1, 42)->getValue() == 42 ? 0 : 1;
+}
@@ -0,0 +1,34 @@
+#include "plugin_interface.hpp"
+
+#include <static_factory_plugin.hpp>
+
+namespace
+{
+
+class PluginDog : public PluginPet
+{
+  public:
+  std::string speak() const override
+  {
+    return "Woof!";
+  }
+};
+
+class PluginCat : public PluginPet
+{
+  public:
+  std::string speak() const override
+  {
+    return "Meow!";
+  }
+};
+
+} // namespace
+
+STATIC_FACTORY_PLUGIN_CREATE(PluginPet, PluginDog, create_plugin_dog)
+STATIC_FACTORY_PLUGIN_CREATE(PluginPet, PluginCat, create_plugin_cat)
+
+STATIC_FACTORY_PLUGIN_TABLE({"PluginPet", "PluginDog", "create_plugin_dog"},
+  {"PluginPet", "PluginCat", "create_plugin_cat"},
+  {"PluginPet", "PluginBird", "create_plugin_bird"}, // never defined, fails on first use only
+  {"OtherInterface", "PluginDog", "create_plugin_dog"});
@@ -0,0 +1,13 @@
+#ifndef STATIC_FACTORY_TEST_PLUGIN_INTERFACE_H
+#define STATIC_FACTORY_TEST_PLUGIN_INTERFACE_H
+
+#include <string>
+
+class PluginPet
+{
+  public:
+  virtual ~PluginPet()              = default;
+  virtual std::string speak() const = 0;
+};
+
+#endif // STATIC_FACTORY_TEST_PLUGIN_INTERFACE_H
@@ -0,0 +1,11 @@
+#include "shared_client.hpp"
+
+int make_in_client(const std::string& key)
+{
+  if(!static_factory<SharedBase>::contains(key))
+  {
+    return -1;
+  }
+
+  return static_factory<SharedBase>::make_unique(key)->getValue();
+}
@@ -0,0 +1,22 @@
+#ifndef STATIC_FACTORY_TEST_SHARED_CLIENT_H
+#define STATIC_FACTORY_TEST_SHARED_CLIENT_H
+
+#include <shared_registry.hpp>
+
+#include <string>
+
+#if defined(_WIN32)
+#if defined(STATIC_FACTORY_SHARED_CLIENT_EXPORTS)
+#define STATIC_FACTORY_SHARED_CLIENT_API __declspec(dllexport)
+#else
+#define STATIC_FACTORY_SHARED_CLIENT_API __declspec(dllimport)
+#endif
+#else
+#define STATIC_FACTORY_SHARED_CLIENT_API __attribute__((visibility("default")))
+#endif
+
+// a second library using the registry of shared_registry without owning it: value of the object
+// made under key, -1 if none is registered
+STATIC_FACTORY_SHARED_CLIENT_API int make_in_client(const std::string& key);
+
+#endif // STATIC_FACTORY_TEST_SHARED_CLIENT_H
@@ -0,0 +1,22 @@
+#include "shared_registry.hpp"
+
+STATIC_FACTORY_DEFINE(SharedBase, std::string);
+
+namespace
+{
+
+class LibraryClass : public SharedBase
+{
+  public:
+  int getValue() const override
+  {
+    return 168;
+  }
+};
+
+} // namespace
+
+void register_library_types()
+{
+  static_factory<SharedBase>::register_type<LibraryClass>("LibraryClass");
+}
@@ -0,0 +1,20 @@
+#ifndef STATIC_FACTORY_TEST_SHARED_REGISTRY_H
+#define STATIC_FACTORY_TEST_SHARED_REGISTRY_H
+
+#include <static_factory.hpp>
+
+#include <string>
+
+class STATIC_FACTORY_API SharedBase
+{
+  public:
+  virtual ~SharedBase()        = default;
+  virtual int getValue() const = 0;
+};
+
+// the registry lives in the shared library, the test executable uses it
+STATIC_FACTORY_DECLARE(SharedBase, std::string);
+
+STATIC_FACTORY_API void register_library_types();
+
+#endif // STATIC_FACTORY_TEST_SHARED_REGISTRY_H
@@ -3,6 +3,11 @@
 
 #include <static_factory.hpp>
 
+#include <atomic>
+#include <latch>
+#include <thread>
+#include <variant>
+
 class BaseClass
 {
   public:
@@ -40,6 +45,9 @@ TEST_CASE("raw pointers")
 
     REQUIRE(objA->getValue() == 42);
     REQUIRE(objB->getValue() == 84);
+
+    delete objA;
+    delete objB;
   }
 
   SECTION("try Create Objects")
@@ -47,6 +55,8 @@ TEST_CASE("raw pointers")
     auto obj = static_factory<BaseClass>::try_make_ptr();
 
     REQUIRE(obj->getValue() == 42);
+
+    delete obj;
   }
 }
 
@@ -150,7 +160,1817 @@ TEST_CASE("variant")
   }
 }
 
-int main(int argc, char* argv[])
+TEST_CASE("variant alternatives")
 {
-  return Catch::Session().run(argc, argv);
-}
\ No newline at end of file
+  using pet_factory = static_factory<pet>;
+
+  pet_factory::register_variant_alternatives<>("alt_dog", "alt_cat");
+
+  SECTION("create registered alternatives")
+  {
+    REQUIRE(std::holds_alternative<dog>(pet_factory::make("alt_dog")));
+    REQUIRE(std::holds_alternative<cat>(pet_factory::make("alt_cat")));
+  }
+
+  SECTION("create alternatives by index")
+  {
+    REQUIRE(std::holds_alternative<dog>(pet_factory::make_alternative(0)));
+    REQUIRE(std::holds_alternative<cat>(pet_factory::make_alternative(
+      pet_factory::alternative_index<cat>())));
+    REQUIRE(std::get<cat>(pet_factory::make_alternative(1, cat{"Anber"})).name == "Anber");
+    REQUIRE_THROWS_AS(pet_factory::make_alternative(2), std::runtime_error);
+    REQUIRE_THROWS_AS(pet_factory::make_alternative(0, 42), std::runtime_error);
+  }
+
+  SECTION("create alternatives by type without registration")
+  {
+    auto obj = pet_factory::make<cat>(cat{"Whiskers"});
+
+    REQUIRE(std::get<cat>(obj).name == "Whiskers");
+  }
+}
+
+struct single_threaded_policies : factory_policies::defaults
+{
+  using locking = factory_policies::no_locking;
+  using storage = factory_policies::hashed_storage;
+};
+
+STATIC_FACTORY_EXTERN_STORAGE(factory_policies::hashed_storage);
+STATIC_FACTORY_INSTANTIATE_STORAGE(factory_policies::hashed_storage);
+
+struct nothrow_policies : factory_policies::defaults
+{
+  using locking = factory_policies::shared_mutex_locking;
+  using error   = factory_policies::nothrow_on_error;
+};
+
+struct length_hash
+{
+  size_t operator()(const std::string& key) const
+  {
+    return key.size();
+  }
+};
+
+struct length_hash_policies : factory_policies::defaults
+{
+  using hash = length_hash;
+};
+
+// a hash of its own, counting its calls
+struct counting_hash
+{
+  static inline std::atomic<int> calls = 0;
+
+  size_t operator()(const std::string& key) const
+  {
+    ++calls;
+    return std::hash<std::string_view>()(key) ^ 0x5bd1e995;
+  }
+};
+
+struct counting_hash_policies : factory_policies::defaults
+{
+  using hash = counting_hash;
+};
+
+// the default policies, for a factory of its own
+struct default_locking_policies : factory_policies::defaults
+{
+};
+
+TEST_CASE("policies")
+{
+  SECTION("no locking and hashed storage")
+  {
+    using factory = static_factory<BaseClass, std::string, single_threaded_policies>;
+
+    factory::register_type<ConcreteClassA>("ClassA");
+    factory::register_type<ConcreteClassB>("ClassB");
+    factory::unregister("ClassA");
+    factory::register_type<ConcreteClassA>("ClassA");
+
+    REQUIRE(factory::make_unique("ClassA")->getValue() == 42);
+    REQUIRE(factory::make_shared("ClassB")->getValue() == 84);
+    REQUIRE(factory::try_make_unique()->getValue() == 84);
+    REQUIRE_THROWS_AS(factory::make_unique("ClassC"), std::runtime_error);
+  }
+
+  SECTION("never throw")
+  {
+    using factory = static_factory<BaseClass, std::string, nothrow_policies>;
+
+    factory::register_type<ConcreteClassA>("ClassA");
+    factory::register_function("Throwing",
+      []() -> BaseClass*
+      {
+        throw std::runtime_error("construction failed");
+      });
+
+    REQUIRE(factory::make_unique("ClassA")->getValue() == 42);
+    REQUIRE(factory::make_unique("ClassC") == nullptr);
+    REQUIRE(factory::make_unique<ConcreteClassB>() == nullptr);
+    REQUIRE(factory::make_ptr("Throwing") == nullptr);
+  }
+
+  SECTION("constructors called without the lock")
+  {
+    using factory = static_factory<BaseClass, std::string, default_locking_policies>;
+
+    factory::register_type<ConcreteClassA>("ClassA");
+
+    // a function making an object of the same factory
+    factory::register_function("Reentrant",
+      []
+      {
+        return factory::make_unique("ClassA");
+      });
+    REQUIRE(factory::make_unique("Reentrant")->getValue() == 42);
+
+    // a function trying the keys of the same factory
+    factory::register_function("TryReentrant",
+      [](int)
+      {
+        return factory::try_make_unique();
+      });
+    REQUIRE(factory::try_make_unique(1)->getValue() == 42);
+
+    // two constructions in progress at once under the default exclusive lock
+    std::latch both(2);
+    factory::register_function("Waiting",
+      [&both]() -> std::unique_ptr<BaseClass>
+      {
+        both.arrive_and_wait();
+        return std::make_unique<ConcreteClassB>();
+      });
+
+    std::unique_ptr<BaseClass> made;
+    std::thread other(
+      [&made]
+      {
+        made = factory::make_unique("Waiting");
+      });
+    REQUIRE(factory::make_unique("Waiting")->getValue() == 84);
+    other.join();
+    REQUIRE(made->getValue() == 84);
+  }
+
+  SECTION("custom hash")
+  {
+    using factory = static_factory<BaseClass, std::string, counting_hash_policies>;
+
+    factory::register_type<ConcreteClassA>("A");
+    factory::register_type<ConcreteClassB>("B");
+
+    REQUIRE(factory::make_unique("A")->getValue() == 42);
+    REQUIRE(factory::make_unique("B")->getValue() == 84);
+    REQUIRE_THROWS_AS(factory::make_unique("C"), std::runtime_error);
+    REQUIRE(counting_hash::calls == 5);
+  }
+}
+
+class ValueClass : public BaseClass
+{
+  public:
+  explicit ValueClass(std::unique_ptr<int> value) : m_value{*value}
+  {
+  }
+
+  int getValue() const override
+  {
+    return m_value;
+  }
+
+  private:
+  int m_value;
+};
+
+TEST_CASE("type erased functions")
+{
+  using factory = static_factory<BaseClass, std::string, single_threaded_policies>;
+
+  int calls = 0;
+  factory::register_function("Counted",
+    [&calls](int value) -> std::unique_ptr<BaseClass>
+    {
+      ++calls;
+      return std::make_unique<ValueClass>(std::make_unique<int>(value));
+    });
+  factory::register_type<ValueClass, std::unique_ptr<int>>("Value");
+
+  REQUIRE(factory::make_unique("Counted", 7)->getValue() == 7);
+  REQUIRE(factory::make_unique("Counted", 8)->getValue() == 8);
+  REQUIRE(calls == 2);
+
+  // move only arguments are forwarded to the constructor
+  REQUIRE(factory::make_unique("Value", std::make_unique<int>(9))->getValue() == 9);
+  REQUIRE(factory::make_shared("Value", std::make_unique<int>(10))->getValue() == 10);
+}
+
+struct tracked
+{
+  static inline int copies = 0;
+  static inline int moves  = 0;
+
+  tracked() = default;
+
+  tracked(const tracked&)
+  {
+    ++copies;
+  }
+
+  tracked(tracked&&) noexcept
+  {
+    ++moves;
+  }
+};
+
+class ByReference : public BaseClass
+{
+  public:
+  explicit ByReference(const tracked&)
+  {
+  }
+
+  int getValue() const override
+  {
+    return 1;
+  }
+};
+
+class ByValue : public BaseClass
+{
+  public:
+  explicit ByValue(tracked value) : m_value{std::move(value)}
+  {
+  }
+
+  int getValue() const override
+  {
+    return 2;
+  }
+
+  private:
+  tracked m_value;
+};
+
+TEST_CASE("argument forwarding")
+{
+  using factory = static_factory<BaseClass>;
+
+  factory::register_type<ByReference, const tracked&>("ByReference");
+  factory::register_type<ByValue, tracked>("ByValue");
+  factory::register_function("Consume",
+    [](std::vector<int>&& buffer) -> BaseClass*
+    {
+      auto consumed = std::move(buffer);
+      return new ByReference(tracked());
+    });
+
+  tracked value;
+  tracked::copies = 0;
+  tracked::moves  = 0;
+
+  // references bind to the argument
+  REQUIRE(factory::make_unique("ByReference", value)->getValue() == 1);
+  REQUIRE(factory::make_unique("ByReference", std::as_const(value))->getValue() == 1);
+  REQUIRE(tracked::copies == 0);
+  REQUIRE(tracked::moves == 0);
+
+  // by value parameters copy lvalues once and move rvalues once (plus the member initialization)
+  REQUIRE(factory::make_unique("ByValue", value)->getValue() == 2);
+  REQUIRE(tracked::copies == 1);
+  REQUIRE(tracked::moves == 1);
+  REQUIRE(factory::make_unique("ByValue", std::move(value))->getValue() == 2);
+  REQUIRE(tracked::copies == 1);
+  REQUIRE(tracked::moves == 3);
+
+  // rvalues reach rvalue reference parameters without copy
+  std::vector<int> buffer(1024, 1);
+  std::unique_ptr<BaseClass> consumer(factory::make_ptr("Consume", std::move(buffer)));
+  REQUIRE(consumer != nullptr);
+  REQUIRE(buffer.empty());
+}
+
+class NamedClass : public BaseClass
+{
+  public:
+  explicit NamedClass(std::string name) : m_name{std::move(name)}
+  {
+  }
+
+  int getValue() const override
+  {
+    return static_cast<int>(m_name.size());
+  }
+
+  private:
+  std::string m_name;
+};
+
+class ScaledClass : public BaseClass
+{
+  public:
+  explicit ScaledClass(double value) : m_value{value}
+  {
+  }
+
+  int getValue() const override
+  {
+    return static_cast<int>(m_value * 2);
+  }
+
+  private:
+  double m_value;
+};
+
+struct converting_policies : factory_policies::defaults
+{
+  using dispatch = factory_policies::converting_dispatch<void(std::string), void(double)>;
+};
+
+TEST_CASE("converting dispatch")
+{
+  using factory = static_factory<BaseClass, std::string, converting_policies>;
+
+  factory::register_type<NamedClass, std::string>("Named");
+  factory::register_type<ScaledClass, double>("Scaled");
+
+  // const char* converts to std::string, int to double
+  REQUIRE(factory::make_unique("Named", "Rex")->getValue() == 3);
+  REQUIRE(factory::make_unique("Named", "Snoopy")->getValue() == 6);
+  REQUIRE(factory::make_unique("Scaled", 21)->getValue() == 42);
+  REQUIRE(factory::make_lazy("Named", "Rex")->getValue() == 3);
+
+  // exact matches take precedence over the conversions
+  factory::register_function("Scaled",
+    [](int value) -> std::unique_ptr<BaseClass>
+    {
+      return std::make_unique<ScaledClass>(value);
+    });
+  REQUIRE(factory::make_unique("Scaled", 21)->getValue() == 42);
+  REQUIRE(factory::make_unique("Scaled", 1.5)->getValue() == 3);
+
+  // the plan of a key and argument types is kept with the key: the next calls do not add any
+  auto usage = factory::memory_usage();
+  for(int i = 0; i < 100; ++i)
+  {
+    REQUIRE(factory::make_unique("Named", "Rex")->getValue() == 3);
+  }
+  REQUIRE(factory::memory_usage().bytes == usage.bytes);
+
+  // the cached plans are invalidated by the registrations
+  factory::unregister<std::string>("Named");
+  REQUIRE_THROWS_AS(factory::make_unique("Named", "Rex"), std::runtime_error);
+  factory::register_type<NamedClass, std::string>("Named");
+  REQUIRE(factory::make_unique("Named", "Rex")->getValue() == 3);
+
+  // without a converting dispatch policy, the argument types must match exactly
+  static_factory<BaseClass>::register_type<NamedClass, std::string>("Named");
+  REQUIRE_THROWS_AS(static_factory<BaseClass>::make_unique("Named", "Rex"), std::runtime_error);
+}
+
+TEST_CASE("key index")
+{
+  using factory = static_factory<BaseClass, std::string, single_threaded_policies>;
+
+  factory::register_type<NamedClass, std::string>("Indexed");
+  factory::register_type<ScaledClass, double>("Indexed");
+
+  // one key, two signatures
+  REQUIRE(factory::contains("Indexed"));
+  REQUIRE(factory::make_unique("Indexed", std::string("Rex"))->getValue() == 3);
+  REQUIRE(factory::make_unique("Indexed", 21.0)->getValue() == 42);
+
+  factory::unregister<std::string>("Indexed");
+  REQUIRE(factory::contains("Indexed"));
+  REQUIRE_THROWS_AS(factory::make_unique("Indexed", std::string("Rex")), std::runtime_error);
+  REQUIRE(factory::make_unique("Indexed", 21.0)->getValue() == 42);
+
+  factory::unregister<double>("Indexed");
+  REQUIRE_FALSE(factory::contains("Indexed"));
+}
+
+class TextMessage : public BaseClass
+{
+  public:
+  // a view into the bytes, not a copy
+  explicit TextMessage(std::span<const std::byte> bytes)
+    : m_text{reinterpret_cast<const char*>(bytes.data()), bytes.size()}
+  {
+  }
+
+  int getValue() const override
+  {
+    return static_cast<int>(m_text.size());
+  }
+
+  std::string_view text() const
+  {
+    return m_text;
+  }
+
+  private:
+  std::string_view m_text;
+};
+
+class CounterMessage : public BaseClass
+{
+  public:
+  explicit CounterMessage(int value) : m_value{value}
+  {
+  }
+
+  int getValue() const override
+  {
+    return m_value;
+  }
+
+  private:
+  int m_value;
+};
+
+TEST_CASE("make from bytes")
+{
+  using factory = static_factory<BaseClass>;
+
+  factory::register_deserializer<TextMessage>("Text");
+  factory::register_deserializer<CounterMessage>("Counter",
+    [](std::span<const std::byte> bytes)
+    {
+      return CounterMessage(std::to_integer<int>(bytes[0]) + std::to_integer<int>(bytes[1]));
+    });
+
+  const std::string text = "hello";
+  auto message           = factory::make_from_bytes("Text", std::as_bytes(std::span(text)));
+  REQUIRE(message->getValue() == 5);
+  REQUIRE(static_cast<TextMessage&>(*message).text().data() == text.data());
+
+  const std::array<std::byte, 2> counter = {std::byte{40}, std::byte{2}};
+  REQUIRE(factory::make_from_bytes("Counter", counter)->getValue() == 42);
+  REQUIRE(factory::make_shared("Counter", std::span<const std::byte>(counter))->getValue() == 42);
+
+  REQUIRE_THROWS_AS(factory::make_from_bytes("Unknown", counter), std::runtime_error);
+
+  // the deserializers of a variant return values, made by value as well
+  using pet_factory = static_factory<pet>;
+
+  STATIC_REQUIRE(std::is_same_v<pet_factory::decoded_type, pet>);
+
+  pet_factory::register_deserializer<cat>("named cat",
+    [](std::span<const std::byte> bytes)
+    {
+      return cat{std::string(reinterpret_cast<const char*>(bytes.data()), bytes.size())};
+    });
+
+  const std::string name = "Anber";
+  auto anber             = pet_factory::make_from_bytes("named cat", std::as_bytes(std::span(name)));
+  REQUIRE(std::get<cat>(anber).name == "Anber");
+}
+
+struct circle
+{
+  double radius = 1;
+};
+
+struct square
+{
+  double side = 1;
+};
+
+using shape = std::variant<circle, square>;
+
+using shape_factory = constexpr_factory<shape,
+  constexpr_entry<"circle", circle>,
+  constexpr_entry<"square", square>>;
+
+TEST_CASE("constexpr factory")
+{
+  SECTION("create Objects at compile time")
+  {
+    constexpr shape small_circle = shape_factory::make<"circle">(0.5);
+    constexpr shape big_square   = shape_factory::make("square", 4.0);
+
+    STATIC_REQUIRE(std::get<circle>(small_circle).radius == 0.5);
+    STATIC_REQUIRE(std::get<square>(big_square).side == 4.0);
+    STATIC_REQUIRE(shape_factory::contains<"circle">());
+    STATIC_REQUIRE(!shape_factory::contains("triangle"));
+  }
+
+  SECTION("create Objects at runtime")
+  {
+    std::string key = "square";
+
+    REQUIRE(std::holds_alternative<square>(shape_factory::make(key)));
+    REQUIRE_THROWS_AS(shape_factory::make("triangle"), std::runtime_error);
+  }
+}
+
+class SectionClass : public BaseClass
+{
+  public:
+  explicit SectionClass(int value = 21) : m_value{value}
+  {
+  }
+
+  int getValue() const override
+  {
+    return m_value;
+  }
+
+  private:
+  int m_value;
+};
+
+using section_factory = static_factory<BaseClass, std::string_view>;
+
+STATIC_FACTORY_REGISTER_IN(section_factory, "SectionClass", SectionClass);
+STATIC_FACTORY_REGISTER_IN(section_factory, "SectionClass", SectionClass, int);
+STATIC_FACTORY_REGISTER(pet, "section_dog", dog);
+
+TEST_CASE("linker section registration")
+{
+  SECTION("create Objects without runtime registration")
+  {
+    auto obj       = section_factory::make_unique("SectionClass");
+    auto obj_value = section_factory::make_shared("SectionClass", 7);
+
+    REQUIRE(obj->getValue() == 21);
+    REQUIRE(obj_value->getValue() == 7);
+  }
+
+  SECTION("create convertible Objects")
+  {
+    REQUIRE(std::holds_alternative<dog>(static_factory<pet>::make("section_dog")));
+  }
+}
+
+// generated from generated_pets.txt
+#include "generated_pets.hpp"
+
+TEST_CASE("generated factory")
+{
+  using generated_factory_t = generated_factory<generated_pets>;
+
+  SECTION("lookup keys")
+  {
+    STATIC_REQUIRE(generated_factory_t::contains("ClassA"));
+    STATIC_REQUIRE(generated_factory_t::contains("SectionClass"));
+    STATIC_REQUIRE(!generated_factory_t::contains("ClassC"));
+  }
+
+  SECTION("create Objects")
+  {
+    auto objA = generated_factory_t::make_unique("ClassA");
+    auto objB = generated_factory_t::make_shared("ClassB");
+    auto objS = std::unique_ptr<BaseClass>(generated_factory_t::make_ptr("SectionClass", 3));
+
+    REQUIRE(objA->getValue() == 42);
+    REQUIRE(objB->getValue() == 84);
+    REQUIRE(objS->getValue() == 3);
+    REQUIRE_THROWS_AS(generated_factory_t::make_unique("ClassC"), std::runtime_error);
+    REQUIRE_THROWS_AS(generated_factory_t::make_unique("ClassA", 3), std::runtime_error);
+  }
+}
+
+#ifdef STATIC_FACTORY_DUMMY_PLUGIN
+
+#include <plugin_interface.hpp>
+#include <static_factory_plugin.hpp>
+
+namespace
+{
+
+class HostPet : public PluginPet
+{
+  public:
+  std::string speak() const override
+  {
+    return "Hello!";
+  }
+};
+
+} // namespace
+
+TEST_CASE("plugin loader")
+{
+  using plugin_factory = static_factory<PluginPet>;
+
+  auto is_open = []()
+  {
+    auto handle = ::dlopen(STATIC_FACTORY_DUMMY_PLUGIN, RTLD_LAZY | RTLD_NOLOAD);
+    if(handle)
+    {
+      ::dlclose(handle);
+    }
+    return handle != nullptr;
+  };
+
+  std::shared_ptr<PluginPet> survivor;
+
+  {
+    plugin_loader<PluginPet> loader("PluginPet");
+
+    REQUIRE(loader.load(STATIC_FACTORY_DUMMY_PLUGIN) == 3);
+    REQUIRE(loader.is_loaded(STATIC_FACTORY_DUMMY_PLUGIN));
+
+    SECTION("create Objects")
+    {
+      REQUIRE(plugin_factory::make_unique("PluginDog")->speak() == "Woof!");
+      REQUIRE(plugin_factory::make_shared("PluginCat")->speak() == "Meow!");
+
+      auto cat = std::unique_ptr<PluginPet>(plugin_factory::make_ptr("PluginCat"));
+      REQUIRE(cat->speak() == "Meow!");
+    }
+
+    SECTION("symbols are resolved on first use")
+    {
+      REQUIRE_THROWS_AS(plugin_factory::make_unique("PluginBird"), std::runtime_error);
+    }
+
+    SECTION("unload keeps the plugin open while shared objects are alive")
+    {
+      survivor = plugin_factory::make_shared("PluginDog");
+
+      REQUIRE(loader.unload(STATIC_FACTORY_DUMMY_PLUGIN));
+      REQUIRE_THROWS_AS(plugin_factory::make_shared("PluginDog"), std::runtime_error);
+      REQUIRE(is_open());
+      REQUIRE(survivor->speak() == "Woof!");
+    }
+
+    SECTION("keys already registered are rejected")
+    {
+      REQUIRE(loader.unload(STATIC_FACTORY_DUMMY_PLUGIN));
+
+      plugin_factory::register_type<HostPet>("PluginCat");
+
+      REQUIRE_THROWS_AS(loader.load(STATIC_FACTORY_DUMMY_PLUGIN), std::runtime_error);
+      REQUIRE(!loader.is_loaded(STATIC_FACTORY_DUMMY_PLUGIN));
+      REQUIRE(!plugin_factory::contains("PluginDog"));
+      REQUIRE(plugin_factory::make_unique("PluginCat")->speak() == "Hello!");
+
+      plugin_factory::unregister("PluginCat");
+    }
+
+    SECTION("unload keeps the functions registered over the plugin keys")
+    {
+      plugin_factory::register_function("PluginDog",
+        []() -> std::shared_ptr<PluginPet>
+        {
+          return std::make_shared<HostPet>();
+        });
+
+      REQUIRE(loader.unload(STATIC_FACTORY_DUMMY_PLUGIN));
+      REQUIRE(plugin_factory::make_shared("PluginDog")->speak() == "Hello!");
+      REQUIRE_THROWS_AS(plugin_factory::make_unique("PluginDog"), std::runtime_error);
+      REQUIRE(!plugin_factory::contains("PluginCat"));
+
+      plugin_factory::unregister("PluginDog");
+    }
+
+    SECTION("compact leaves the plugin closable")
+    {
+      // a callable packed in the arena of compact(), which outlives the plugin keys
+      plugin_factory::register_function("LocalPet",
+        [name = std::string("local")]() -> std::shared_ptr<PluginPet>
+        {
+          return nullptr;
+        });
+      plugin_factory::compact();
+
+      REQUIRE(plugin_factory::make_unique("PluginDog")->speak() == "Woof!");
+      REQUIRE(loader.unload(STATIC_FACTORY_DUMMY_PLUGIN));
+      REQUIRE(!is_open());
+      REQUIRE(plugin_factory::contains("LocalPet"));
+
+      plugin_factory::unregister("LocalPet");
+    }
+  }
+
+  survivor.reset();
+
+  REQUIRE(!is_open());
+}
+
+#endif
+
+#include <shared_client.hpp>
+#include <shared_registry.hpp>
+
+namespace
+{
+
+class ExecutableClass : public SharedBase
+{
+  public:
+  int getValue() const override
+  {
+    return 336;
+  }
+};
+
+} // namespace
+
+TEST_CASE("registry shared across libraries")
+{
+  register_library_types();
+
+  SECTION("registered by the library, created by the executable")
+  {
+    auto obj = static_factory<SharedBase>::make_unique("LibraryClass");
+
+    REQUIRE(obj->getValue() == 168);
+  }
+
+  SECTION("registered by a library, created by another library")
+  {
+    REQUIRE(make_in_client("LibraryClass") == 168);
+  }
+
+  SECTION("registered by the executable, created by a library")
+  {
+    static_factory<SharedBase>::register_type<ExecutableClass>("ExecutableClass");
+
+    REQUIRE(make_in_client("ExecutableClass") == 336);
+    REQUIRE(make_in_client("Unknown") == -1);
+
+    static_factory<SharedBase>::unregister("ExecutableClass");
+  }
+}
+
+#include <static_factory_stream.hpp>
+
+#include <cstdio>
+
+namespace
+{
+
+void write_record(std::string& out, std::string_view key, std::string_view payload)
+{
+  detail::record_header header{uint32_t(key.size()), uint32_t(payload.size())};
+  out.append(reinterpret_cast<const char*>(&header), sizeof(header));
+  out.append(key);
+  out.append(payload);
+}
+
+} // namespace
+
+TEST_CASE("record stream")
+{
+  using factory = static_factory<BaseClass>;
+
+  factory::register_deserializer<TextMessage>("Text");
+
+  std::string records;
+  for(int i = 0; i < 1000; ++i)
+  {
+    write_record(records, "Text", std::string(size_t(i % 10), 'x'));
+  }
+
+  auto check = [](record_stream<factory>& stream)
+  {
+    record_stream<factory>::batch batch;
+    int index = 0;
+    while(stream.next(batch))
+    {
+      for(auto& object : batch.objects)
+      {
+        REQUIRE(object->getValue() == index++ % 10);
+      }
+    }
+    REQUIRE(index == 1000);
+    REQUIRE(stream.records() == 1000);
+  };
+
+  SECTION("mapped file")
+  {
+    auto file = std::tmpfile();
+    std::fwrite(records.data(), 1, records.size(), file);
+    std::fflush(file);
+
+    // chunks smaller than the file, batches smaller than the chunks
+    record_stream<factory> stream(fileno(file), {.read_size = 1000, .batch_size = 64});
+    check(stream);
+
+    std::fclose(file);
+  }
+
+  SECTION("pipe")
+  {
+    int fds[2];
+    REQUIRE(::pipe(fds) == 0);
+
+    bool written = true;
+    std::thread writer(
+      [&]
+      {
+        // records split across reads
+        for(size_t offset = 0; offset < records.size(); offset += 777)
+        {
+          auto size = std::min<size_t>(777, records.size() - offset);
+          written   = written && ::write(fds[1], records.data() + offset, size) == ssize_t(size);
+        }
+        ::close(fds[1]);
+      });
+
+    {
+      record_stream<factory> stream(fds[0], {.read_size = 512});
+      check(stream);
+    }
+
+    writer.join();
+    ::close(fds[0]);
+    REQUIRE(written);
+  }
+
+  SECTION("pipe chunks filled across reads")
+  {
+    int fds[2];
+    REQUIRE(::pipe(fds) == 0);
+
+    std::thread writer(
+      [&]
+      {
+        // small writes, each read returns at most one of them
+        for(size_t offset = 0; offset < records.size(); offset += 100)
+        {
+          auto size = std::min<size_t>(100, records.size() - offset);
+          if(::write(fds[1], records.data() + offset, size) != ssize_t(size))
+          {
+            break;
+          }
+          std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+        ::close(fds[1]);
+      });
+
+    std::vector<std::shared_ptr<const record_stream<factory>::chunk>> chunks;
+    {
+      record_stream<factory> stream(fds[0], {.read_size = 4096});
+      record_stream<factory>::batch batch;
+      while(stream.next(batch))
+      {
+        for(auto& chunk : batch.chunks)
+        {
+          if(std::find(chunks.begin(), chunks.end(), chunk) == chunks.end())
+          {
+            chunks.push_back(chunk);
+          }
+        }
+      }
+      REQUIRE(stream.records() == 1000);
+    }
+
+    writer.join();
+    ::close(fds[0]);
+
+    // every chunk but the last holds read_size bytes, less the incomplete record left to the next
+    REQUIRE(chunks.size() > 1);
+    for(size_t i = 0; i + 1 < chunks.size(); ++i)
+    {
+      REQUIRE(chunks[i]->bytes.size() > 4096 - 64);
+    }
+  }
+
+  SECTION("values")
+  {
+    using pet_factory = static_factory<pet>;
+
+    pet_factory::register_deserializer<dog>("named dog",
+      [](std::span<const std::byte> bytes)
+      {
+        return dog{std::string(reinterpret_cast<const char*>(bytes.data()), bytes.size())};
+      });
+
+    std::string pets;
+    write_record(pets, "named dog", "Rex");
+    write_record(pets, "named dog", "Fido");
+
+    auto file = std::tmpfile();
+    std::fwrite(pets.data(), 1, pets.size(), file);
+    std::fflush(file);
+
+    record_stream<pet_factory> stream(fileno(file));
+    record_stream<pet_factory>::batch batch;
+    REQUIRE(stream.next(batch));
+    REQUIRE(batch.objects.size() == 2);
+    REQUIRE(std::get<dog>(batch.objects[0]).name == "Rex");
+    REQUIRE(std::get<dog>(batch.objects[1]).name == "Fido");
+    REQUIRE(!stream.next(batch));
+
+    std::fclose(file);
+  }
+
+  SECTION("errors")
+  {
+    std::string invalid = records;
+    write_record(invalid, "Unknown", "payload");
+    write_record(invalid, "Text", "truncated");
+    invalid.pop_back();
+
+    auto file = std::tmpfile();
+    std::fwrite(invalid.data(), 1, invalid.size(), file);
+    std::fflush(file);
+
+    record_stream<factory> stream(fileno(file));
+    record_stream<factory>::batch batch;
+    REQUIRE_THROWS_AS(
+      [&]
+      {
+        while(stream.next(batch))
+        {
+        }
+      }(),
+      std::runtime_error);
+
+    std::fclose(file);
+  }
+}
+
+#include <static_factory_graph.hpp>
+
+#include <charconv>
+#include <fstream>
+
+template <typename Pointer>
+class GraphClass : public BaseClass
+{
+  public:
+  explicit GraphClass(graph_node<Pointer>&& node) : m_children{std::move(node.children)}
+  {
+    for(auto arg : node.args)
+    {
+      int value = 0;
+      std::from_chars(arg.data(), arg.data() + arg.size(), value);
+      m_value += value;
+    }
+  }
+
+  // the arguments of the subtree
+  int getValue() const override
+  {
+    int value = m_value;
+    for(auto& child : m_children)
+    {
+      value += child->getValue();
+    }
+    return value;
+  }
+
+  private:
+  int m_value = 0;
+  std::vector<Pointer> m_children;
+};
+
+TEST_CASE("graph loader")
+{
+  using factory = static_factory<BaseClass>;
+  using unique  = std::unique_ptr<BaseClass>;
+  using shared  = std::shared_ptr<BaseClass>;
+
+  factory::register_type<GraphClass<unique>, graph_node<unique>>("node");
+  factory::register_type<GraphClass<shared>, graph_node<shared>>("node");
+  factory::register_type<GraphClass<unique>, graph_node<unique>>("leaf");
+
+  char path_template[] = "/tmp/static_factory_graph_XXXXXX";
+  ::close(::mkstemp(path_template));
+  const std::string path = path_template;
+
+  SECTION("small graph")
+  {
+    std::ofstream(path) << "# two roots\n"
+                           "node(1, \"2\") {\n"
+                           "  leaf(3)\n"
+                           "  node { leaf(4) leaf() }\n"
+                           "}\n"
+                           "leaf(5)\n";
+
+    auto graph = graph_loader<factory>::load_unique(path);
+    REQUIRE(graph.roots.size() == 2);
+    REQUIRE(graph.roots[0]->getValue() == 10);
+    REQUIRE(graph.roots[1]->getValue() == 5);
+  }
+
+  SECTION("large graph built in parallel")
+  {
+    // 64 subtrees of 100 nodes under a root, and a deep chain
+    std::ofstream config(path);
+    config << "node(1) {\n";
+    for(int i = 0; i < 64; ++i)
+    {
+      config << "  node(1) {";
+      for(int j = 0; j < 99; ++j)
+      {
+        config << " node(1)";
+      }
+      config << " }\n";
+    }
+    for(int i = 0; i < 10000; ++i)
+    {
+      config << "node(0) {";
+    }
+    config << std::string(10000, '}') << "\n}\n";
+    config.close();
+
+    auto graph = graph_loader<factory>::load_shared(path, {.threads = 4, .min_parallel_nodes = 16});
+    REQUIRE(graph.roots.size() == 1);
+    REQUIRE(graph.roots[0]->getValue() == 6401);
+  }
+
+  SECTION("errors")
+  {
+    std::ofstream(path) << "node(1 { }";
+    REQUIRE_THROWS_AS(graph_loader<factory>::load_unique(path), std::runtime_error);
+
+    std::ofstream(path) << "unknown(1)";
+    REQUIRE_THROWS_AS(graph_loader<factory>::load_unique(path), std::runtime_error);
+  }
+
+  std::remove(path.c_str());
+}
+
+#include <static_factory_container.hpp>
+
+class ServiceClass : public BaseClass
+{
+  public:
+  using dependencies = service_dependencies<BaseClass, std::string>;
+
+  explicit ServiceClass(const dependencies& deps) : m_value{1}
+  {
+    for(size_t i = 0; i < deps.size(); ++i)
+    {
+      m_value += deps.get(i)->getValue();
+    }
+    ++s_constructed;
+  }
+
+  // one plus the values of the dependencies
+  int getValue() const override
+  {
+    return m_value;
+  }
+
+  static inline std::atomic<int> s_constructed = 0;
+
+  private:
+  int m_value;
+};
+
+TEST_CASE("service container")
+{
+  using factory = static_factory<BaseClass>;
+
+  ServiceClass::s_constructed = 0;
+
+  service_container<factory> services;
+  services.register_service<ServiceClass>("config");
+  services.register_service<ServiceClass>("logger", {"config"});
+  services.register_service<ServiceClass>("cache", {"config"});
+  services.register_service<ServiceClass>("database", {"config", "logger", "cache"});
+
+  SECTION("lazy singletons")
+  {
+    auto database = services.resolve<ServiceClass>("database");
+    REQUIRE(database);
+    REQUIRE(database->getValue() == 6);
+    REQUIRE(ServiceClass::s_constructed == 4);
+
+    REQUIRE(services.resolve("database") == database);
+    REQUIRE(services.resolve("config")->getValue() == 1);
+    REQUIRE(ServiceClass::s_constructed == 4);
+  }
+
+  SECTION("concurrent resolution")
+  {
+    std::vector<std::shared_ptr<BaseClass>> resolved(8);
+    std::vector<std::thread> threads;
+    for(size_t i = 0; i < resolved.size(); ++i)
+    {
+      threads.emplace_back(
+        [&, i]
+        {
+          resolved[i] = services.resolve(i % 2 ? "database" : "logger");
+        });
+    }
+    for(auto& t : threads)
+    {
+      t.join();
+    }
+
+    REQUIRE(ServiceClass::s_constructed == 4);
+    REQUIRE(resolved[0] == resolved[2]);
+    REQUIRE(resolved[1] == resolved[3]);
+  }
+
+  SECTION("build all")
+  {
+    // a wide level depending on the database
+    for(int i = 0; i < 32; ++i)
+    {
+      services.register_service<ServiceClass>("handler" + std::to_string(i), {"database", "logger"});
+    }
+
+    services.resolve("logger");
+    services.build_all(4);
+    REQUIRE(ServiceClass::s_constructed == 36);
+    REQUIRE(services.resolve("handler31")->getValue() == 9);
+
+    services.build_all(4);
+    REQUIRE(ServiceClass::s_constructed == 36);
+  }
+
+  SECTION("duplicate services")
+  {
+    auto logger = services.resolve("logger");
+
+    // a registered service is kept, with its dependencies and its instance
+    REQUIRE_THROWS_AS(services.register_service<ServiceClass>("config"), std::runtime_error);
+    REQUIRE_THROWS_AS(services.add_service("logger"), std::runtime_error);
+    REQUIRE(services.resolve("logger") == logger);
+    REQUIRE(services.resolve("cache")->getValue() == 2);
+    REQUIRE(ServiceClass::s_constructed == 3);
+  }
+
+  SECTION("errors")
+  {
+    services.register_service<ServiceClass>("first", {"second"});
+    services.register_service<ServiceClass>("second", {"first"});
+    REQUIRE_THROWS_AS(services.resolve("first"), std::runtime_error);
+    REQUIRE_THROWS_AS(services.build_all(), std::runtime_error);
+
+    service_container<factory> missing;
+    missing.register_service<ServiceClass>("orphan", {"unknown"});
+    REQUIRE_THROWS_AS(missing.resolve("orphan"), std::runtime_error);
+    REQUIRE_THROWS_AS(missing.resolve("unknown"), std::runtime_error);
+    REQUIRE(ServiceClass::s_constructed == 0);
+  }
+}
+
+class LazyClass : public BaseClass
+{
+  public:
+  explicit LazyClass(std::string name) : m_name{std::move(name)}
+  {
+    if(m_name.empty())
+    {
+      throw std::invalid_argument("empty name");
+    }
+    ++s_constructed;
+  }
+
+  int getValue() const override
+  {
+    return int(m_name.size());
+  }
+
+  static inline std::atomic<int> s_constructed = 0;
+
+  private:
+  std::string m_name;
+};
+
+TEST_CASE("lazy pointers")
+{
+  using factory = static_factory<BaseClass>;
+
+  factory::register_type<LazyClass, std::string>("lazy");
+  LazyClass::s_constructed = 0;
+
+  SECTION("constructed on first use")
+  {
+    std::string name = "four";
+    auto lazy        = factory::make_lazy("lazy", name);
+    name             = "changed";
+
+    REQUIRE(lazy);
+    REQUIRE_FALSE(lazy.constructed());
+    REQUIRE(LazyClass::s_constructed == 0);
+
+    REQUIRE(lazy->getValue() == 4);
+    REQUIRE(lazy.constructed());
+
+    auto copy = lazy;
+    REQUIRE(copy.get() == lazy.get());
+    REQUIRE(LazyClass::s_constructed == 1);
+  }
+
+  SECTION("unused objects are never made")
+  {
+    {
+      auto lazy = factory::make_lazy(factory::prepare("lazy"), std::string("unused"));
+    }
+    REQUIRE(LazyClass::s_constructed == 0);
+  }
+
+  SECTION("concurrent first use")
+  {
+    auto lazy = factory::make_lazy("lazy", std::string("shared"));
+
+    std::vector<BaseClass*> objects(8);
+    std::vector<std::thread> threads;
+    for(size_t i = 0; i < objects.size(); ++i)
+    {
+      threads.emplace_back(
+        [&, i]
+        {
+          objects[i] = lazy.get();
+        });
+    }
+    for(auto& t : threads)
+    {
+      t.join();
+    }
+
+    REQUIRE(LazyClass::s_constructed == 1);
+    REQUIRE(std::count(objects.begin(), objects.end(), objects[0]) == 8);
+  }
+
+  SECTION("errors")
+  {
+    REQUIRE_THROWS_AS(factory::make_lazy("unknown", std::string("name")), std::runtime_error);
+    REQUIRE_FALSE(lazy_ptr<BaseClass>());
+
+    auto lazy = factory::make_lazy("lazy", std::string());
+    REQUIRE_THROWS_AS(lazy.get(), std::invalid_argument);
+    REQUIRE_THROWS_AS(lazy.get(), std::invalid_argument);
+    REQUIRE_FALSE(lazy.constructed());
+  }
+}
+
+#include <static_factory_capture.hpp>
+
+struct capture_policies : factory_policies::defaults
+{
+  using instrumentation = factory_policies::capture_instrumentation;
+};
+
+TEST_CASE("workload capture and replay")
+{
+  using captured = static_factory<BaseClass, std::string, capture_policies>;
+  using factory  = static_factory<BaseClass>;
+
+  captured::register_type<ConcreteClassA>("A");
+  captured::register_type<ConcreteClassB>("B");
+  captured::register_type<NamedClass, std::string>("Named");
+  factory::register_type<ConcreteClassA>("A");
+  factory::register_type<ConcreteClassB>("B");
+  factory::register_type<NamedClass, std::string>("Named");
+
+  char path_template[] = "/tmp/static_factory_capture_XXXXXX";
+  ::close(::mkstemp(path_template));
+  const std::string path = path_template;
+
+  // not logged outside of a capture
+  captured::make_unique("A");
+
+  workload_capture::start(path);
+  REQUIRE_THROWS_AS(workload_capture::start(path), std::runtime_error);
+
+  std::vector<std::thread> threads;
+  for(int t = 0; t < 2; ++t)
+  {
+    threads.emplace_back(
+      [t]
+      {
+        for(int i = 0; i < 5000; ++i)
+        {
+          captured::make_unique(i % 3 ? "A" : "B");
+        }
+        if(t == 0)
+        {
+          captured::make_shared("Named", std::string("Rex"));
+          captured::try_make_unique();
+        }
+      });
+  }
+  for(auto& t : threads)
+  {
+    t.join();
+  }
+  delete captured::make_ptr("B");
+
+  REQUIRE(workload_capture::stop() == 10003);
+
+  auto log = workload_log::load(path);
+  REQUIRE(log.records.size() == 10003);
+  REQUIRE(log.signatures.size() == 3);
+  REQUIRE(std::is_sorted(log.records.begin(),
+    log.records.begin() + 4096,
+    [](auto& a, auto& b)
+    {
+      return a.timestamp < b.timestamp;
+    }));
+
+  SECTION("full speed")
+  {
+    workload_replay<factory> replay(log);
+    replay.bind<std::unique_ptr<BaseClass>>();
+    replay.bind<std::shared_ptr<BaseClass>, std::string>("Rex");
+
+    auto report = replay.run();
+    REQUIRE(report.calls == 10002);
+    REQUIRE(report.skipped == 1);
+    REQUIRE(report.failed == 0);
+    REQUIRE(report.calls_per_second > 0);
+    REQUIRE(report.p50 <= report.p99);
+    REQUIRE(report.p99 <= report.max);
+  }
+
+  SECTION("original pacing")
+  {
+    workload_replay<factory> replay(log);
+    replay.bind<BaseClass*>();
+
+    auto report = replay.run({.original_pacing = true});
+    REQUIRE(report.calls == 1);
+    REQUIRE(report.skipped == 10002);
+    REQUIRE(report.seconds * 1e9 >= double(log.records.back().timestamp));
+  }
+
+  SECTION("errors")
+  {
+    std::ofstream(path) << "not a capture";
+    REQUIRE_THROWS_AS(workload_log::load(path), std::runtime_error);
+
+    // a header, a signature table and a footer whose sizes do not fit in the file
+    auto write_capture = [&path](uint64_t signatures_offset, uint32_t signature_count, uint32_t name_size)
+    {
+      std::ofstream out(path, std::ios::binary);
+      detail::capture_header header;
+      detail::capture_footer footer{signatures_offset, signature_count};
+      out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+      out.write(reinterpret_cast<const char*>(&name_size), sizeof(name_size));
+      out.write("name", 4);
+      out.write(reinterpret_cast<const char*>(&footer), sizeof(footer));
+    };
+
+    write_capture(0, 1, 4);
+    REQUIRE_THROWS_AS(workload_log::load(path), std::runtime_error);
+
+    write_capture(sizeof(detail::capture_header) + 1000 * sizeof(detail::capture_record), 1, 4);
+    REQUIRE_THROWS_AS(workload_log::load(path), std::runtime_error);
+
+    write_capture(sizeof(detail::capture_header), 0x7fffffff, 4);
+    REQUIRE_THROWS_AS(workload_log::load(path), std::runtime_error);
+
+    write_capture(sizeof(detail::capture_header), 1, 0xffffffff);
+    REQUIRE_THROWS_AS(workload_log::load(path), std::runtime_error);
+
+    write_capture(sizeof(detail::capture_header), 1, 4);
+    REQUIRE(workload_log::load(path).signatures == std::vector<std::string>{"name"});
+  }
+
+  std::remove(path.c_str());
+}
+
+#include <static_factory_trace.hpp>
+
+#include <sstream>
+
+struct trace_policies : factory_policies::defaults
+{
+  using instrumentation = factory_policies::trace_instrumentation;
+};
+
+TEST_CASE("factory tracer")
+{
+  using factory = static_factory<BaseClass, std::string, trace_policies>;
+
+  factory::register_type<ConcreteClassA>("A");
+
+  char path_template[] = "/tmp/static_factory_trace_XXXXXX";
+  ::close(::mkstemp(path_template));
+  const std::string path = path_template;
+
+  auto read_trace = [&path]
+  {
+    std::stringstream trace;
+    trace << std::ifstream(path).rdbuf();
+    return trace.str();
+  };
+
+  auto count = [](const std::string& str, const std::string& pattern)
+  {
+    size_t n = 0;
+    for(auto pos = str.find(pattern); pos != std::string::npos; pos = str.find(pattern, pos + 1))
+    {
+      ++n;
+    }
+    return n;
+  };
+
+  SECTION("chrome trace")
+  {
+    factory_tracer::start();
+
+    factory::register_type<NamedClass, std::string>("Named");
+
+    std::vector<std::thread> threads;
+    for(int t = 0; t < 2; ++t)
+    {
+      threads.emplace_back(
+        []
+        {
+          for(int i = 0; i < 10; ++i)
+          {
+            factory::make_unique("A");
+          }
+        });
+    }
+    for(auto& t : threads)
+    {
+      t.join();
+    }
+    factory::make_shared("Named", std::string("Rex"));
+    factory::try_make_unique();
+
+    factory_tracer::stop();
+    factory::make_unique("A");
+
+    REQUIRE(factory_tracer::write_chrome_trace(path) == 23);
+
+    auto trace = read_trace();
+    REQUIRE(trace.starts_with("{\"displayTimeUnit\":\"ns\",\"traceEvents\":["));
+    REQUIRE(count(trace, "\"ph\":\"X\"") == 23);
+    REQUIRE(count(trace, "\"name\":\"make A\"") == 20);
+    REQUIRE(count(trace, "\"name\":\"make Named\"") == 1);
+    REQUIRE(count(trace, "\"name\":\"register Named\"") == 1);
+    REQUIRE(count(trace, "\"name\":\"try_make\"") == 1);
+    REQUIRE(count(trace, "\"type\":\"NamedClass\"") == 1);
+    REQUIRE(count(trace, "\"lock_wait_ns\":") == 23);
+    REQUIRE(trace.find("std::unique_ptr<BaseClass") != std::string::npos);
+    REQUIRE(trace.find("\"lost_events\":0") != std::string::npos);
+
+    // drained
+    REQUIRE(factory_tracer::write_chrome_trace(path) == 0);
+  }
+
+  SECTION("ring overflow")
+  {
+    factory_tracer::start(4);
+    for(int i = 0; i < 10; ++i)
+    {
+      factory::make_unique("A");
+    }
+    factory_tracer::stop();
+
+    REQUIRE(factory_tracer::write_chrome_trace(path) == 4);
+    REQUIRE(read_trace().find("\"lost_events\":6") != std::string::npos);
+  }
+
+  SECTION("drain while the thread writes")
+  {
+    factory_tracer::start(8);
+
+    std::atomic<bool> done = false;
+    std::thread writer(
+      [&done]
+      {
+        for(int i = 0; i < 20000; ++i)
+        {
+          factory::make_unique("A");
+        }
+        done = true;
+      });
+
+    // the events torn by the writer are dropped, the written ones are all complete
+    while(!done)
+    {
+      factory_tracer::write_chrome_trace(path);
+      auto trace = read_trace();
+      REQUIRE(count(trace, "\"ph\":\"X\"") == count(trace, "\"name\":\"make A\""));
+    }
+    writer.join();
+    factory_tracer::stop();
+    factory_tracer::write_chrome_trace(path);
+  }
+
+  std::remove(path.c_str());
+}
+
+#include <static_factory_sampling.hpp>
+
+#include <numeric>
+
+struct sampling_policies : factory_policies::defaults
+{
+  using instrumentation = factory_policies::sampling_instrumentation;
+};
+
+TEST_CASE("sampling instrumentation")
+{
+  using factory = static_factory<BaseClass, std::string, sampling_policies>;
+
+  factory::register_type<ConcreteClassA>("A");
+
+  factory_sampler::set_period(4);
+  factory_sampler::reset();
+
+  char path_template[] = "/tmp/static_factory_sampling_XXXXXX";
+  ::close(::mkstemp(path_template));
+  const std::string path = path_template;
+
+  factory_tracer::start();
+
+  // the counters of the threads are kept after they exit, one in 4 calls of each thread is sampled
+  std::vector<std::thread> threads;
+  for(int t = 0; t < 2; ++t)
+  {
+    threads.emplace_back(
+      []
+      {
+        for(int i = 0; i < 100; ++i)
+        {
+          factory::make_unique("A");
+        }
+        try
+        {
+          factory::make_unique("missing");
+        }
+        catch(const std::runtime_error&)
+        {
+        }
+        factory::try_make_unique();
+        factory::try_make_unique();
+        factory::try_make_unique();
+      });
+  }
+  for(auto& t : threads)
+  {
+    t.join();
+  }
+
+  factory_tracer::stop();
+
+  auto stats = factory_sampler::snapshot();
+  REQUIRE(stats.calls == 208);
+  REQUIRE(stats.sampled == 52);
+  REQUIRE(std::accumulate(stats.histogram.begin(), stats.histogram.end(), uint64_t(0)) == 52);
+  REQUIRE(stats.mean_latency() > 0);
+  REQUIRE(stats.estimated_total() >= stats.mean_latency() * 200);
+  REQUIRE(stats.percentile(0.5) <= stats.percentile(0.99));
+
+  // the sampled calls are recorded by the tracer
+  REQUIRE(factory_tracer::write_chrome_trace(path) == 52);
+
+  // every call sampled: the recorded events keep the key and the signature of their call
+  factory_sampler::set_period(1);
+  factory_tracer::start();
+  std::thread(
+    []
+    {
+      factory::make_unique("A");
+      factory::make_shared("A");
+    })
+    .join();
+  factory_tracer::stop();
+
+  REQUIRE(factory_tracer::write_chrome_trace(path) == 2);
+  std::stringstream trace;
+  trace << std::ifstream(path).rdbuf();
+  REQUIRE(trace.str().find("\"name\":\"make A\"") != std::string::npos);
+  REQUIRE(trace.str().find("std::unique_ptr<BaseClass") != std::string::npos);
+  REQUIRE(trace.str().find("std::shared_ptr<BaseClass") != std::string::npos);
+  std::remove(path.c_str());
+
+  factory_sampler::reset();
+  REQUIRE(factory_sampler::snapshot().calls == 0);
+
+  factory_sampler::set_period(0);
+  REQUIRE(factory_sampler::period() == 1);
+  factory_sampler::set_period(1024);
+}
+
+#include <static_factory_accounting.hpp>
+
+TEST_CASE("object accounting")
+{
+  using factory   = static_factory<BaseClass>;
+  using accounted = accounted_factory<factory>;
+
+  accounted::register_type<ConcreteClassA>("Accounted A");
+  accounted::register_type<NamedClass, std::string>("Accounted Named");
+
+  auto find = [](const std::string& key)
+  {
+    for(auto& account : accounted::snapshot())
+    {
+      if(account.key == key)
+      {
+        return account;
+      }
+    }
+    return key_account<std::string>{key};
+  };
+
+  SECTION("disabled")
+  {
+    auto a = accounted::make_unique("Accounted A");
+    auto b = accounted::make_shared("Accounted A");
+    accounted::destroy("Accounted A", accounted::make_ptr("Accounted A"));
+
+    REQUIRE(a->getValue() == 42);
+    REQUIRE(b);
+    REQUIRE(a.get_deleter().account == accounted::no_account);
+    REQUIRE(find("Accounted A").made == 0);
+  }
+
+  SECTION("enabled")
+  {
+    accounted::enable();
+
+    auto a = accounted::make_unique("Accounted A");
+    auto b = accounted::make_shared("Accounted A");
+    auto c = accounted::make_ptr("Accounted Named", std::string("Rex"));
+
+    REQUIRE(c->getValue() == 3);
+    REQUIRE(find("Accounted A").size == sizeof(ConcreteClassA));
+    REQUIRE(find("Accounted A").live == 2);
+    REQUIRE(find("Accounted A").bytes == 2 * int64_t(sizeof(ConcreteClassA)));
+    REQUIRE(find("Accounted Named").live == 1);
+
+    // destroyed by another thread, whose counters are kept after it exits
+    std::thread([&]
+      {
+        a.reset();
+        auto copy = b;
+        b.reset();
+        accounted::destroy("Accounted Named", c);
+      }).join();
+
+    REQUIRE(find("Accounted A").made == 2);
+    REQUIRE(find("Accounted A").live == 0);
+    REQUIRE(find("Accounted A").bytes == 0);
+    REQUIRE(find("Accounted Named").live == 0);
+
+    // the keys registered directly in the factory are counted without their size
+    factory::register_type<ConcreteClassB>("Unaccounted B");
+    auto d = accounted::make_unique("Unaccounted B");
+    REQUIRE(find("Unaccounted B").live == 1);
+    REQUIRE(find("Unaccounted B").bytes == 0);
+    d.reset();
+
+    // failed calls are not counted
+    REQUIRE_THROWS(accounted::make_unique("missing"));
+    REQUIRE(find("missing").made == 0);
+
+    accounted::enable(false);
+  }
+
+  SECTION("colliding hashes")
+  {
+    using colliding = accounted_factory<static_factory<BaseClass, std::string, length_hash_policies>>;
+
+    // the keys of the same length share the function of the factory, not their account
+    colliding::register_type<ConcreteClassA>("A");
+    colliding::enable();
+
+    auto a = colliding::make_unique("A");
+    auto b = colliding::make_unique("B");
+    auto c = colliding::make_unique("B");
+
+    std::vector<key_account<std::string>> accounts;
+    for(auto& account : colliding::snapshot())
+    {
+      if(account.live != 0)
+      {
+        accounts.push_back(account);
+      }
+    }
+    REQUIRE(accounts.size() == 2);
+    REQUIRE(accounts[0].key == "A");
+    REQUIRE(accounts[0].live == 1);
+    REQUIRE(accounts[0].bytes == int64_t(sizeof(ConcreteClassA)));
+    REQUIRE(accounts[1].key == "B");
+    REQUIRE(accounts[1].live == 2);
+    REQUIRE(accounts[1].bytes == 0);
+
+    colliding::enable(false);
+  }
+}
+
+#include <static_factory_profile.hpp>
+
+struct profile_policies : factory_policies::defaults
+{
+  using instrumentation = factory_policies::profile_instrumentation;
+};
+
+TEST_CASE("registration profiler")
+{
+  using factory = static_factory<BaseClass, std::string, profile_policies>;
+
+  registration_profiler::clear();
+
+  factory::register_type<ConcreteClassA>("A");
+  factory::register_type<NamedClass, std::string>("Named");
+  factory::register_function("Lambda",
+    []
+    {
+      return std::make_unique<ConcreteClassB>();
+    });
+
+  auto records = registration_profiler::records();
+  REQUIRE(records.size() == 3);
+
+  REQUIRE(records[0].key == "A");
+  REQUIRE(*records[0].type == typeid(ConcreteClassA));
+  REQUIRE(*records[0].registry == typeid(factory));
+  REQUIRE(records[0].usage.keys == 1);
+  REQUIRE(records[0].usage.functions == 3); // BaseClass*, std::shared_ptr and std::unique_ptr
+  REQUIRE(records[0].usage.states == 0);
+
+  REQUIRE(*records[1].signature == typeid(void (*)(std::string)));
+  REQUIRE(records[1].usage.keys == 2);
+  REQUIRE(records[1].usage.signatures == 6);
+  REQUIRE(records[1].usage.bytes > records[0].usage.bytes);
+
+  REQUIRE(records[2].usage.keys == 3);
+  REQUIRE(records[2].usage.states == 1);
+  REQUIRE(records[2].start >= records[0].start);
+
+  char path_template[] = "/tmp/static_factory_profile_XXXXXX";
+  ::close(::mkstemp(path_template));
+  const std::string path = path_template;
+
+  registration_profiler::write_report(path);
+
+  std::stringstream report;
+  report << std::ifstream(path).rdbuf();
+  REQUIRE(report.str().starts_with("static_factory registrations: 3 in "));
+  REQUIRE(report.str().find("Named: NamedClass(std::") != std::string::npos);
+  REQUIRE(report.str().find("static_factory<BaseClass") != std::string::npos);
+
+  std::remove(path.c_str());
+}
+
+struct compaction_policies : factory_policies::defaults
+{
+  using storage = factory_policies::hashed_storage;
+};
+
+TEST_CASE("memory usage and compaction")
+{
+  using factory = static_factory<BaseClass, std::string, compaction_policies>;
+
+  constexpr size_t count = 100;
+  for(size_t i = 0; i < count; ++i)
+  {
+    auto key = "Named" + std::to_string(i);
+    factory::register_function(key,
+      [key]
+      {
+        return std::make_unique<NamedClass>(key);
+      });
+    factory::register_type<ConcreteClassA>("A" + std::to_string(i));
+  }
+
+  auto lazy = factory::make_lazy("Named7");
+
+  auto before = factory::memory_usage();
+  REQUIRE(before.keys == 2 * count);
+  REQUIRE(before.functions == 4 * count);
+  REQUIRE(before.states == count);
+  REQUIRE(before.state_bytes >= count * sizeof(std::string));
+
+  factory::compact();
+
+  auto after = factory::memory_usage();
+  REQUIRE(after.keys == before.keys);
+  REQUIRE(after.functions == before.functions);
+  REQUIRE(after.state_bytes == before.state_bytes);
+  REQUIRE(after.bytes < before.bytes);
+
+  // the packed states are moved, the one referenced by the lazy_ptr is left in place
+  for(size_t i = 0; i < count; ++i)
+  {
+    REQUIRE(factory::make_unique("Named" + std::to_string(i))->getValue() == int(("Named" + std::to_string(i)).size()));
+    REQUIRE(factory::make_unique("A" + std::to_string(i))->getValue() == 42);
+  }
+  REQUIRE(lazy->getValue() == 6);
+
+  // compact again, the arena of the previous compact is packed with the new registrations
+  factory::register_function("Late",
+    []
+    {
+      return std::make_unique<NamedClass>("Late");
+    });
+  factory::compact();
+  REQUIRE(factory::make_unique("Late")->getValue() == 4);
+  REQUIRE(factory::make_unique("Named42")->getValue() == 7);
+
+  REQUIRE_FALSE(factory::sealed());
+  factory::seal();
+  REQUIRE(factory::sealed());
+  REQUIRE_THROWS_AS(factory::register_type<ConcreteClassB>("B"), std::runtime_error);
+  REQUIRE_THROWS_AS(factory::unregister("A0"), std::runtime_error);
+  REQUIRE(factory::make_unique("A0")->getValue() == 42);
+  REQUIRE(factory::memory_usage().keys == 2 * count + 1);
+}
+
+int main(int argc, char* argv[])
+{
+  return Catch::Session().run(argc, argv);
+}
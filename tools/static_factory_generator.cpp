@@ -0,0 +1,356 @@
+//
+// static_factory_generator: generates a generated_factory registry header from a manifest.
+//
+// usage: static_factory_generator <manifest> <output header> [<source dir>]
+//
+// the generated header names the manifest by its path relative to the source dir, the current
+// directory by default, so that it does not depend on the checkout.
+//
+// manifest format, one directive per line, '#' starts a comment:
+//
+//   name    pet_registry          name of the generated registry struct (default: manifest file name)
+//   base    Pet                   base type of the registered types
+//   include "pets.hpp"            header included by the generated header, repeatable
+//   type    Dog  Dog              key and registered type, repeatable
+//
+// the keys are placed in a minimal perfect hash table: a key lands in a bucket, and the seed of
+// the bucket places it in its own slot. exits with 1 on a duplicated key, or if no seed places
+// the keys of a bucket within max_seed_tries tries.
+//
+
+#include <static_factory_hash.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+struct entry
+{
+  std::string key;
+  std::string type;
+};
+
+struct manifest
+{
+  std::string name;
+  std::string base;
+  std::vector<std::string> includes;
+  std::vector<entry> entries;
+};
+
+// seeds tried per bucket before giving up: a bucket of a few distinct keys is placed in far less
+constexpr uint64_t max_seed_tries = uint64_t(1) << 24;
+
+struct perfect_hash
+{
+  std::vector<uint64_t> seeds;
+  std::vector<size_t> slots; // slot of each entry
+};
+
+std::string stem(const std::string& path)
+{
+  auto begin = path.find_last_of("/\\");
+  begin      = begin == std::string::npos ? 0 : begin + 1;
+  auto end   = path.find('.', begin);
+  return path.substr(begin, end == std::string::npos ? std::string::npos : end - begin);
+}
+
+manifest parse(const std::string& path)
+{
+  std::ifstream file(path);
+  if(!file)
+  {
+    throw std::runtime_error("cannot open " + path);
+  }
+
+  manifest result;
+  result.name = stem(path);
+
+  std::string line;
+  for(size_t line_number = 1; std::getline(file, line); ++line_number)
+  {
+    line = line.substr(0, line.find('#'));
+
+    std::istringstream tokens(line);
+    std::string directive;
+    if(!(tokens >> directive))
+    {
+      continue;
+    }
+
+    std::string value;
+    std::getline(tokens >> std::ws, value);
+    while(!value.empty() && std::isspace(static_cast<unsigned char>(value.back())))
+    {
+      value.pop_back();
+    }
+
+    auto error = [&](const std::string& message)
+    {
+      return std::runtime_error(path + ":" + std::to_string(line_number) + ": " + message);
+    };
+
+    if(value.empty())
+    {
+      throw error("missing value for " + directive);
+    }
+
+    if(directive == "name")
+    {
+      result.name = value;
+    }
+    else if(directive == "base")
+    {
+      result.base = value;
+    }
+    else if(directive == "include")
+    {
+      result.includes.push_back(value);
+    }
+    else if(directive == "type")
+    {
+      std::istringstream fields(value);
+      entry e;
+      fields >> e.key >> std::ws;
+      std::getline(fields, e.type);
+      if(e.type.empty())
+      {
+        throw error("expected: type <key> <type>");
+      }
+      if(std::any_of(result.entries.begin(),
+           result.entries.end(),
+           [&](const entry& other)
+           {
+             return other.key == e.key;
+           }))
+      {
+        throw error("duplicated key " + e.key);
+      }
+      result.entries.push_back(std::move(e));
+    }
+    else
+    {
+      throw error("unknown directive " + directive);
+    }
+  }
+
+  if(result.base.empty())
+  {
+    throw std::runtime_error(path + ": missing base directive");
+  }
+  if(result.entries.empty())
+  {
+    throw std::runtime_error(path + ": no type registered");
+  }
+
+  return result;
+}
+
+perfect_hash build_perfect_hash(const std::vector<entry>& entries)
+{
+  const size_t nslots   = entries.size();
+  const size_t nbuckets = std::max<size_t>(1, entries.size() / 4);
+
+  std::vector<std::vector<size_t>> buckets(nbuckets);
+  for(size_t i = 0; i < entries.size(); ++i)
+  {
+    buckets[detail::fnv1a(entries[i].key, 0) % nbuckets].push_back(i);
+  }
+
+  // place the largest buckets first, while the table is still empty
+  std::vector<size_t> order(nbuckets);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(),
+    order.end(),
+    [&](size_t a, size_t b)
+    {
+      return buckets[a].size() > buckets[b].size();
+    });
+
+  perfect_hash result;
+  result.seeds.resize(nbuckets, 0);
+  result.slots.resize(entries.size());
+
+  std::vector<bool> taken(nslots, false);
+  std::vector<size_t> candidate_slots;
+
+  for(auto bucket : order)
+  {
+    if(buckets[bucket].empty())
+    {
+      continue;
+    }
+
+    for(uint64_t seed = 1;; ++seed)
+    {
+      if(seed > max_seed_tries)
+      {
+        std::string keys;
+        for(auto i : buckets[bucket])
+        {
+          keys += " " + entries[i].key;
+        }
+        throw std::runtime_error("no perfect hash found after " + std::to_string(max_seed_tries) +
+                                 " seeds for the keys" + keys);
+      }
+
+      candidate_slots.clear();
+      for(auto i : buckets[bucket])
+      {
+        auto slot = detail::fnv1a(entries[i].key, seed) % nslots;
+        if(taken[slot] ||
+          std::find(candidate_slots.begin(), candidate_slots.end(), slot) != candidate_slots.end())
+        {
+          break;
+        }
+        candidate_slots.push_back(slot);
+      }
+
+      if(candidate_slots.size() == buckets[bucket].size())
+      {
+        result.seeds[bucket] = seed;
+        for(size_t j = 0; j < candidate_slots.size(); ++j)
+        {
+          taken[candidate_slots[j]]        = true;
+          result.slots[buckets[bucket][j]] = candidate_slots[j];
+        }
+        break;
+      }
+    }
+  }
+
+  return result;
+}
+
+std::string escape(const std::string& str)
+{
+  std::string result;
+  for(char c : str)
+  {
+    if(c == '"' || c == '\\')
+    {
+      result += '\\';
+    }
+    result += c;
+  }
+  return result;
+}
+
+void generate(const manifest& m, const perfect_hash& hash, const std::string& manifest_path, std::ostream& out)
+{
+  std::vector<const entry*> by_slot(m.entries.size());
+  for(size_t i = 0; i < m.entries.size(); ++i)
+  {
+    by_slot[hash.slots[i]] = &m.entries[i];
+  }
+
+  std::string guard = "STATIC_FACTORY_GENERATED_" + m.name + "_H";
+  std::transform(guard.begin(),
+    guard.end(),
+    guard.begin(),
+    [](unsigned char c)
+    {
+      return std::isalnum(c) ? static_cast<char>(std::toupper(c)) : '_';
+    });
+
+  out << "// generated by static_factory_generator from " << manifest_path << ", do not edit\n\n";
+  out << "#ifndef " << guard << "\n#define " << guard << "\n\n";
+  out << "#include <static_factory.hpp>\n\n";
+  out << "#include <array>\n#include <cstdint>\n#include <string_view>\n#include <type_traits>\n";
+  for(auto& include : m.includes)
+  {
+    out << "#include " << include << "\n";
+  }
+
+  out << "\nstruct " << m.name << "\n{\n";
+  out << "  using base_type = " << m.base << ";\n\n";
+
+  out << "  static constexpr std::array<uint64_t, " << hash.seeds.size() << "> seeds = {";
+  for(size_t i = 0; i < hash.seeds.size(); ++i)
+  {
+    out << (i % 8 == 0 ? "\n    " : " ") << hash.seeds[i] << "u,";
+  }
+  out << "\n  };\n\n";
+
+  out << "  static constexpr std::array<std::string_view, " << by_slot.size() << "> keys = {";
+  for(auto e : by_slot)
+  {
+    out << "\n    \"" << escape(e->key) << "\",";
+  }
+  out << "\n  };\n\n";
+
+  out << "  template <typename Visitor>\n";
+  out << "  static decltype(auto) visit(size_t slot, Visitor&& visitor)\n  {\n";
+  out << "    switch(slot)\n    {\n";
+  for(size_t slot = 0; slot < by_slot.size(); ++slot)
+  {
+    out << "    case " << slot << ": return visitor(std::type_identity<" << by_slot[slot]->type
+        << ">());\n";
+  }
+  out << "    default: return visitor(std::type_identity<void>());\n";
+  out << "    }\n  }\n};\n\n";
+
+  out << "#endif // " << guard << "\n";
+}
+
+// path of the manifest relative to source_dir, with '/' separators
+std::string relative_path(const std::string& path, const std::string& source_dir)
+{
+  auto absolute = std::filesystem::absolute(path).lexically_normal();
+  auto relative = absolute.lexically_relative(std::filesystem::absolute(source_dir).lexically_normal());
+  return relative.empty() ? absolute.filename().generic_string() : relative.generic_string();
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  if(argc != 3 && argc != 4)
+  {
+    std::cerr << "usage: " << argv[0] << " <manifest> <output header> [<source dir>]\n";
+    return 2;
+  }
+
+  try
+  {
+    auto m    = parse(argv[1]);
+    auto hash = build_perfect_hash(m.entries);
+
+    std::ostringstream header;
+    generate(m, hash, relative_path(argv[1], argc == 4 ? argv[3] : "."), header);
+
+    // leave the header untouched when nothing changed, so dependents are not rebuilt
+    std::ifstream previous(argv[2]);
+    std::stringstream previous_content;
+    previous_content << previous.rdbuf();
+    if(previous && previous_content.str() == header.str())
+    {
+      return 0;
+    }
+
+    std::ofstream out(argv[2]);
+    out << header.str();
+    if(!out)
+    {
+      throw std::runtime_error(std::string("cannot write ") + argv[2]);
+    }
+  }
+  catch(const std::exception& e)
+  {
+    std::cerr << "static_factory_generator: " << e.what() << "\n";
+    return 1;
+  }
+
+  return 0;
+}